@@ -11,6 +11,7 @@ public:
     BitBuffer(DataRate datarate_, FluxDecoder& decoder);
 
     const std::vector<uint8_t>& data() const;
+    const std::vector<int>& indexes() const;
     bool wrapped() const;
     int size() const;
     int remaining() const;
@@ -28,6 +29,7 @@ public:
     void sync_lost();
     void clear();
     void add(uint8_t bit);
+    void add_bits(uint32_t bits, int count);
     void remove(int num_bits);
 
     uint8_t read1();
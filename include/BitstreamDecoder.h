@@ -2,6 +2,23 @@
 
 #include "BitBuffer.h"
 
+// Encoding to scan for when none was given with --encoding. It's held per
+// thread for the lifetime of the object, so a hint for one batch job can't
+// change how other jobs decode. ThreadPool tasks inherit it from the caller.
+class ScanEncodingHint
+{
+public:
+    explicit ScanEncodingHint(Encoding encoding);
+    ~ScanEncodingHint();
+    ScanEncodingHint(const ScanEncodingHint&) = delete;
+    ScanEncodingHint& operator=(const ScanEncodingHint&) = delete;
+
+    static Encoding get();
+
+private:
+    Encoding m_prev_encoding;
+};
+
 void scan_flux(TrackData& trackdata);
 void scan_flux_mfm_fm(TrackData& trackdata, DataRate last_datarate);
 void scan_flux_amiga(TrackData& trackdata);
@@ -16,6 +16,11 @@ public:
     DataRate datarate() const;
     Encoding encoding() const;
 
+protected:
+    void addEncodedByte(uint8_t byte, uint32_t bits, int count) override;
+
 private:
     BitBuffer m_buffer;
+    std::vector<uint8_t> m_bytes{};     // bytes written since the last raw bit or encoding change
+    int m_bytes_end = 0;                // bit position after the last byte in m_bytes
 };
@@ -19,5 +19,7 @@ protected:
     virtual TrackData load(const CylHead& cylhead, bool first_read = false) = 0;
     virtual void save(TrackData& trackdata);
 
+    void merge_retry(TrackData& trackdata, TrackData&& retry_trackdata);
+
     std::bitset<MAX_DISK_CYLS * MAX_DISK_HEADS> m_loaded{};
 };
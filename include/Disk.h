@@ -17,6 +17,7 @@ public:
     explicit Disk(Format& format);
 
     virtual bool preload(const Range& range, int cyl_step);
+    virtual bool preencode(PreferredData data);
     virtual void clear();
 
     virtual const TrackData& read(const CylHead& cylhead, bool uncached = false);
@@ -33,8 +34,8 @@ public:
 
     void format(const RegularFormat& reg_fmt, const Data& data = Data(), bool cyls_first = false);
     void format(const Format& fmt, const Data& data = Data(), bool cyls_first = false);
-    void flip_sides();
-    void resize(int cyls, int heads);
+    virtual void flip_sides();
+    virtual void resize(int cyls, int heads);
 
     bool find(const Header& header, const Sector*& found_sector);
     const Sector& get_sector(const Header& header);
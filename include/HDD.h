@@ -26,7 +26,10 @@ public:
     bool Seek(int64_t sector) const;
     int Read(void* pv, int sectors, bool byte_swap = false) const;
     int Write(void* pv, int sectors, bool byte_swap = false);
+    bool Zero(int64_t sector, int64_t count);
+    bool Discard(int64_t sector, int64_t count);
     bool Copy(HDD* phSrc_, int64_t uSectors_, int64_t uSrcOffset_ = 0, int64_t uDstOffset_ = 0, int64_t uTotal_ = 0, const char* pcszAction_ = nullptr);
+    bool Rescue(HDD* phSrc_, int64_t uSectors_, const std::string& map_path, const std::string& map_identity);
 
     void SetIdentifyData(const IDENTIFYDEVICE* pIdentify_ = nullptr);
 
@@ -34,6 +37,8 @@ public:
     static bool IsRecognised(const std::string& path);
     static std::shared_ptr<HDD> OpenDisk(const std::string& path);
     static std::shared_ptr<HDD> CreateDisk(const std::string& path, int64_t llTotalBytes_, const IDENTIFYDEVICE* pIdentify_ = nullptr, bool fOverwrite_ = false);
+    static std::string CopyMapIdentity(const std::string& src_path, const HDD& src, const std::string& dst_path, const HDD& dst);
+    static bool CheckCopyMap(const std::string& map_path, const std::string& identity);
 
 public:
     virtual bool SafetyCheck();
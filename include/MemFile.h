@@ -2,6 +2,7 @@
 
 enum class Compress { None, Zip, Gzip, Bzip2, Xz };
 std::string to_string(const Compress& compress);
+void CompressFile(FILE* in, FILE* out, Compress compress, const std::string& filename);
 
 
 class MemFile
@@ -12,6 +13,7 @@ public:
         const std::string& filename = "");
 
     const Data& data() const;
+    Data release();
     int size() const;
     int remaining() const;
     const std::string& path() const;
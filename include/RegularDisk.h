@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Disk.h"
+
+// Regular-format disk, with tracks built on demand from the flat image data
+class RegularDisk final : public Disk
+{
+public:
+    RegularDisk(const Format& format, Data&& data, bool cyls_first = false);
+
+    bool preencode(PreferredData data) override;
+    const TrackData& read(const CylHead& cylhead, bool uncached = false) override;
+    const TrackData& write(TrackData&& trackdata) override;
+    void clear() override;
+    void flip_sides() override;
+    void resize(int cyls, int heads) override;
+
+    bool pristine() const;
+    const uint8_t* sector_data(const Header& header, int& bytes) const;
+
+private:
+    Track build_track(const CylHead& cylhead) const;
+    int track_offset(const CylHead& cylhead) const;
+    void load_all();
+
+    Format m_format{};
+    Data m_data{};
+    bool m_cyls_first = false;
+    bool m_pristine = true;
+    std::bitset<MAX_DISK_CYLS * MAX_DISK_HEADS> m_loaded{};
+};
@@ -58,6 +58,7 @@ typedef void* HANDLE;
 #include <vector>
 #include <map>
 #include <set>
+#include <tuple>
 #include <memory>    // for unique_ptr
 #include <algorithm> // for sort
 #include <functional>
@@ -79,6 +80,7 @@ typedef void* HANDLE;
 #include <fcntl.h>
 #include <chrono>
 #include <thread>
+#include <mutex>
 #include <cassert>
 #include <system_error>
 
@@ -189,6 +191,16 @@ static const int MAX_IMAGE_SIZE = 256 * 1024 * 1024;    // 256MiB
 
 enum { GAPS_AUTO = -1, GAPS_NONE, GAPS_CLEAN, GAPS_ALL };
 
+struct BatchJob
+{
+    std::string source{};
+    std::string target{};
+};
+
+// batch
+std::vector<BatchJob> ReadBatchList(const std::string& path);
+bool RunBatch(const std::vector<BatchJob>& jobs, const std::function<bool(const BatchJob&)>& run_job);
+
 // copy
 bool ImageToImage(const std::string& src_path, const std::string& dst_path);
 bool Image2Trinity(const std::string& path, const std::string& trinity_path);
@@ -202,10 +214,26 @@ bool CreateImage(const std::string& path, Range range);
 bool CreateHddImage(const std::string& path, int nSizeMB_);
 
 // dir
+using UsedTracks = std::bitset<MAX_DISK_CYLS * MAX_DISK_HEADS>;
 bool Dir(Disk& disk);
+UsedTracks GetUsedTracks(Disk& disk);
 bool DirImage(const std::string& path);
 bool IsMgtDirSector(const Sector& sector);
 
+// records
+struct RecordInfo
+{
+    int record = 0;
+    bool formatted = false;
+    int files = 0;
+    uint64_t checksum = 0;
+    std::string label{};        // from the record list
+    std::string disk_label{};   // from the MGT directory
+};
+
+std::vector<RecordInfo> GetRecordIndex(HDD& hdd, const std::string& path, const BDOS_CAPS& bdc, bool labels_only);
+bool ExportRecords(const std::string& hdd_path, const std::string& dir_path);
+
 // list
 bool ListDrives(int nVerbose_);
 bool ListRecords(const std::string& path);
@@ -221,10 +249,14 @@ bool FormatBoot(const std::string& path);
 bool FormatRecord(const std::string& path);
 bool FormatImage(const std::string& path, Range range);
 bool UnformatImage(const std::string& path, Range range);
+bool VerifyImage(const std::string& src_path, const std::string& dst_path, Range range);
 
 // rpm
 bool DiskRpm(const std::string& path);
 
+// index
+bool IndexImages(const std::string& dir_path, const std::string& index_path);
+
 // info
 bool HddInfo(const std::string& path, int nVerbose_);
 bool ImageInfo(const std::string& path);
@@ -238,8 +270,6 @@ bool ViewBoot(const std::string& path, Range range);
 bool CheckDriver();
 bool ReportDriverVersion();
 
-enum class PreferredData { Unknown, Track, Bitstream, Flux };
-
 struct OPTIONS
 {
     Range range{};
@@ -257,18 +287,19 @@ struct OPTIONS
     int lba = 0, hdf = 0, resize = 0, cpm = 0, minimal = 0, legacy = 0;
     int absoffsets = 0, datacopy = 0, align = 0, keepoverlap = 0, fmoverlap = 0;
     int rescans = 0, flip = 0, multiformat = 0, rpm = 0, tty = 0, time = 0;
-    int a1sync = 0;
+    int a1sync = 0, discard = 0;
 
     int retries = 5, maxcopies = 3;
     int scale = 100, pllphase = DEFAULT_PLL_PHASE;
     int bytes_begin = 0, bytes_end = std::numeric_limits<int>::max();
     int bitskip = -1;
+    int blocksize = 0;
 
     Encoding encoding{ Encoding::Unknown };
     DataRate datarate{ DataRate::Unknown };
     PreferredData prefer = PreferredData::Unknown;
     long sectors = -1;
-    std::string label{}, boot{};
+    std::string label{}, boot{}, mapfile{}, batch{};
 
     char szSource[MAX_PATH], szTarget[MAX_PATH];
 
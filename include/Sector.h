@@ -44,9 +44,9 @@ public:
     int data_size() const;
 
     const DataList& datas() const;
-    DataList& datas();
     const Data& data_copy(int copy = 0) const;
-    Data& data_copy(int copy = 0);
+    DataList& writable_datas();
+    Data& writable_data_copy(int copy = 0);
 
     Merge add(Data&& data, bool bad_crc = false, uint8_t dam = 0xfb);
     int copies() const;
@@ -65,6 +65,6 @@ public:
 private:
     bool m_bad_id_crc = false;
     bool m_bad_data_crc = false;
-    std::vector<Data> m_data{};         // copies of sector data
+    std::shared_ptr<DataList> m_data{}; // copies of sector data, shared with sector copies until changed
 };
 #pragma once
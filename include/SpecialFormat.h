@@ -14,6 +14,9 @@ bool IsPrehistorikTrack(const Track &track);
 bool Is11SectorTrack(const Track &track);
 bool IsReussirProtectedTrack (const Track &track);
 
+const BitBuffer& EmptyTrackBitstream (DataRate datarate, Encoding encoding, int track_bytes);
+bool IsEmptyTrackBitstream (const BitBuffer &bitbuf);
+
 TrackData GenerateEmptyTrack (const CylHead &cylhead, const Track &track);
 TrackData GenerateKBI19Track (const CylHead &cylhead, const Track &track);
 TrackData GenerateSpectrumSpeedlockTrack (const CylHead &cylhead, const Track &track, int weak_offset, int weak_size);
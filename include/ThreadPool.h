@@ -3,6 +3,8 @@
 #include <future>
 #include <queue>
 
+#include "BitstreamDecoder.h"
+
 class ThreadPool
 {
 public:
@@ -81,9 +83,15 @@ auto ThreadPool::enqueue(F&& f, Args&&... args)
 
     std::future<ret_type> res = task->get_future();
 
+    // Tasks decode with the same encoding hint as the thread queuing them
+    auto encoding = ScanEncodingHint::get();
+
     std::unique_lock<std::mutex> lock(_mutex);
     if (!_stop)
-        _tasks.emplace([task]() { (*task)(); });
+        _tasks.emplace([task, encoding]() {
+            ScanEncodingHint hint(encoding);
+            (*task)();
+            });
     lock.unlock();
     _cond.notify_one();
 
@@ -3,11 +3,30 @@
 #include "Sector.h"
 #include "Format.h"
 
+#include <unordered_map>
+
 class Track
 {
 public:
     enum class AddResult { Unchanged, Append, Insert, Merge };
 
+    // Snapshot of sector positions by header, for repeated look-ups on a
+    // track that isn't changing. Rebuild it after adding or removing sectors.
+    class HeaderIndex
+    {
+    public:
+        explicit HeaderIndex(const Track& track);
+
+        int find(const Header& header, DataRate datarate, Encoding encoding) const;
+        bool is_repeated(const Sector& sector) const;
+
+    private:
+        static uint64_t key(const Header& header);
+
+        std::reference_wrapper<const Track> m_track;
+        std::unordered_map<uint64_t, std::vector<int>> m_indices{};
+    };
+
 public:
     explicit Track(int sectors = 0);    // sectors to reserve
 
@@ -57,6 +76,7 @@ public:
 
 private:
     std::vector<Sector> m_sectors{};
+    bool m_offset_ordered = true;   // sectors are known to be in offset order
 
     // Max bitstream position difference for sectors to be considered the same.
     // Used to match sectors between revolutions, and needs to cope with the
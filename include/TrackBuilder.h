@@ -44,6 +44,9 @@ public:
     void addRX02Sector(const Header& header, const Data& data, int gap3_bytes);
 
 protected:
+    // Encoded bits for a complete data byte, most significant first.
+    virtual void addEncodedByte(uint8_t byte, uint32_t bits, int count);
+
     Encoding m_encoding{ Encoding::MFM };
     DataRate m_datarate{ DataRate::Unknown };
     bool m_lastbit{ false };
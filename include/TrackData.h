@@ -3,6 +3,8 @@
 #include "Track.h"
 #include "BitBuffer.h"
 
+enum class PreferredData { Unknown, Track, Bitstream, Flux };
+
 class TrackData
 {
 public:
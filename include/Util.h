@@ -107,6 +107,8 @@ const char* CHR(int cyl, int head, int record);
 const char* CHSR(int cyl, int head, int sector, int record);
 
 extern std::set<std::string> seen_messages;
+extern std::mutex message_mutex;
+extern thread_local std::set<std::string> captured_messages;
 
 template <typename ...Args>
 void Message(MsgType type, const char* pcsz_, Args&& ...args)
@@ -116,12 +118,22 @@ void Message(MsgType type, const char* pcsz_, Args&& ...args)
     if (type == msgError)
         throw util::exception(msg);
 
+    // Captured output is for a single batch job, so has no status line and
+    // its own record of messages already shown.
+    auto capturing = util::LogHelper::capture != nullptr;
+    if (capturing && type == msgStatus)
+        return;
+
+    // Messages may come from worker threads, such as during preloading
+    std::lock_guard<std::mutex> lock(message_mutex);
+
     if (type != msgStatus)
     {
-        if (seen_messages.find(msg) != seen_messages.end())
+        auto& seen = capturing ? captured_messages : seen_messages;
+        if (seen.find(msg) != seen.end())
             return;
 
-        seen_messages.insert(msg);
+        seen.insert(msg);
     }
 
     switch (type)
@@ -172,9 +184,25 @@ bool IsFileExt(const std::string& path, const std::string& ext);
 int64_t FileSize(const std::string& path);
 int GetFileType(const char* pcsz_);
 void ByteSwap(void* pv, size_t nSize_);
+bool IsZeroFilled(const void* pv, size_t len);
+uint64_t Fnv1a(const void* pv, size_t len, uint64_t hash = 0xcbf29ce484222325ULL);
+
+// Little-endian values in binary index files
+template <typename T>
+void WriteValue(std::ostream& os, T value)
+{
+    value = util::htole(value);
+    os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+T ReadValue(std::istream& is)
+{
+    T value{};
+    is.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return util::letoh(value);
+}
 int TPeek(const uint8_t* buf, int offset = 0);
-void TrackUsedInit(Disk& disk);
-bool IsTrackUsed(int cyl_, int head_);
 
 void CalculateGeometry(int64_t total_sectors, int& cyls, int& heads, int& sectors);
 void ValidateRange(Range& range, int max_cyls, int max_heads, int cyl_step = 1, int def_cyls = -1, int def_heads = -1);
@@ -4,12 +4,14 @@ using IMAGE_READFUNC = bool (*)(MemFile&, std::shared_ptr<Disk>&);
 using IMAGE_WRITEFUNC = bool (*)(FILE*, std::shared_ptr<Disk>&);
 using DEVICE_READFUNC = bool(*)(const std::string&, std::shared_ptr<Disk>&);
 using DEVICE_WRITEFUNC = bool(*)(const std::string&, std::shared_ptr<Disk>&);
+using IMAGE_PROBEFUNC = bool(*)(const std::string&, std::shared_ptr<Disk>&);
 
 struct IMAGE_ENTRY
 {
     const char* pszType;
     IMAGE_READFUNC pfnRead;
     IMAGE_WRITEFUNC pfnWrite;
+    PreferredData writeData = PreferredData::Track;   // form the writer reads tracks in
 };
 
 struct DEVICE_ENTRY
@@ -19,6 +21,12 @@ struct DEVICE_ENTRY
     DEVICE_WRITEFUNC pfnWrite;
 };
 
+struct PROBE_ENTRY
+{
+    const char* pszType;
+    IMAGE_PROBEFUNC pfnProbe;
+};
+
 #define DECLARATIONS_ONLY
 #include "types.cpp"
 #undef DECLARATIONS_ONLY
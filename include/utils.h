@@ -207,6 +207,9 @@ struct LogHelper
     std::ostream* file;
     bool statusmsg = false;
     bool clearline = false;
+
+    // Optional per-thread redirection, used to buffer the output of batch jobs
+    static thread_local std::ostream* capture;
 };
 
 extern LogHelper cout;
@@ -218,6 +221,12 @@ LogHelper& operator<<(LogHelper& h, ttycmd cmd);
 template <typename T>
 LogHelper& operator<<(LogHelper& h, const T& t)
 {
+    if (LogHelper::capture)
+    {
+        *LogHelper::capture << t;
+        return h;
+    }
+
     if (h.clearline)
     {
         h.clearline = false;
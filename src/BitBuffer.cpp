@@ -51,6 +51,11 @@ const std::vector<uint8_t>& BitBuffer::data() const
     return m_data;
 }
 
+const std::vector<int>& BitBuffer::indexes() const
+{
+    return m_indexes;
+}
+
 bool BitBuffer::wrapped() const
 {
     return m_wrapped || m_bitsize == 0;
@@ -148,6 +153,45 @@ void BitBuffer::add(uint8_t bit)
     m_bitsize = std::max(m_bitsize, ++m_bitpos);
 }
 
+// Add up to 32 bits, most significant first
+void BitBuffer::add_bits(uint32_t bits, int count)
+{
+    assert(count >= 0 && count <= 32);
+
+    // Double the size if we run out of space
+    while (static_cast<size_t>((m_bitpos + count + 7) / 8) > m_data.size())
+    {
+        assert(m_data.size() != 0);
+        m_data.resize(m_data.size() * 2);
+        if (opt.debug) util::cout << "BitBuffer size grown to " << m_data.size() << "\n";
+    }
+
+    // Whole bytes can be stored directly, with the bit order reversed
+    while (count >= 8 && !(m_bitpos & 7))
+    {
+        auto byte = static_cast<uint8_t>(bits >> (count - 8));
+        util::bit_reverse(&byte, 1);
+        m_data[m_bitpos / 8] = byte;
+        m_bitpos += 8;
+        count -= 8;
+    }
+
+    while (count-- > 0)
+    {
+        auto& b = m_data[m_bitpos / 8];
+        uint8_t bit_value = 1 << (m_bitpos & 7);
+
+        if ((bits >> count) & 1)
+            b |= bit_value;
+        else
+            b &= ~bit_value;
+
+        ++m_bitpos;
+    }
+
+    m_bitsize = std::max(m_bitsize, m_bitpos);
+}
+
 void BitBuffer::remove(int num_bits)
 {
     assert(m_bitpos >= num_bits);
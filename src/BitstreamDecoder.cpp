@@ -11,14 +11,71 @@
 
 static const int JITTER_PERCENT = 2;
 
+// Fewer reversals than this can't hold even a single address mark
+static const size_t BLANK_MIN_REVERSALS = 64;
+// Reversals within this spread of each other can't form any sync pattern
+static const int BLANK_SPREAD_PERCENT = 25;
+
+// Check for flux with no sectors to find, either because there are too few
+// reversals, or because they all have the same spacing (such as a track of
+// MFM zeros). Anything else stops the check early, so it costs very little.
+static bool IsBlankFlux(const FluxData& flux_revs)
+{
+    for (auto& flux_times : flux_revs)
+    {
+        if (flux_times.size() < BLANK_MIN_REVERSALS)
+            continue;
+
+        // Skip the partial times either side of the index
+        auto min_time = flux_times[1], max_time = flux_times[1];
+        for (size_t i = 2; i < flux_times.size() - 1; ++i)
+        {
+            min_time = std::min(min_time, flux_times[i]);
+            max_time = std::max(max_time, flux_times[i]);
+
+            // 64-bit, as long unformatted gaps would overflow a 32-bit product
+            if (uint64_t(max_time) * 100 > uint64_t(min_time) * (100 + BLANK_SPREAD_PERCENT))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static thread_local Encoding hint_encoding = Encoding::Unknown;
+
+ScanEncodingHint::ScanEncodingHint(Encoding encoding)
+    : m_prev_encoding(hint_encoding)
+{
+    hint_encoding = encoding;
+}
+
+ScanEncodingHint::~ScanEncodingHint()
+{
+    hint_encoding = m_prev_encoding;
+}
+
+/*static*/ Encoding ScanEncodingHint::get()
+{
+    return hint_encoding;
+}
+
+// The single encoding to scan for, or Unknown to scan for all of them
+static Encoding RequestedEncoding()
+{
+    return (opt.encoding != Encoding::Unknown) ? opt.encoding : hint_encoding;
+}
+
+
 // Scan track flux reversals for sectors. We default to the order MFM/FM,
 // Amiga, then GCR. On subsequent calls the last successful encoding is
 // checked first, as it's the most likely.
 
 void scan_flux(TrackData& trackdata)
 {
-    static DataRate last_datarate = DataRate::_250K;
-    static Encoding last_encoding = Encoding::MFM;
+    // Per-thread hints, as tracks from different disks may decode in parallel
+    static thread_local DataRate last_datarate = DataRate::_250K;
+    static thread_local Encoding last_encoding = Encoding::MFM;
 
     // Return an empty track if we have no data
     if (trackdata.flux().empty())
@@ -34,12 +91,25 @@ void scan_flux(TrackData& trackdata)
     track.tracktime = static_cast<int>(total_time / 1000);
     trackdata.add(std::move(track));
 
+    // Blank tracks skip the format scan and get the shared empty bitstream,
+    // sized for the track time in whole milliseconds. There's no data to
+    // give the rate, so use the last one found, to match the rest of the disk.
+    if (IsBlankFlux(trackdata.flux()))
+    {
+        auto track_ms = (total_time + 500'000) / 1'000'000;
+        if (!track_ms)
+            track_ms = 200;
+
+        auto track_bytes = static_cast<int>(track_ms * bits_per_second(last_datarate) / 8 / 1000);
+        trackdata.add(BitBuffer(EmptyTrackBitstream(last_datarate, Encoding::MFM, track_bytes)));
+        return;
+    }
 
     std::vector<Encoding> encodings;
-    if (opt.encoding != Encoding::Unknown)
+    if (RequestedEncoding() != Encoding::Unknown)
     {
         // Just the one requested format.
-        encodings = { opt.encoding };
+        encodings = { RequestedEncoding() };
     }
     else
     {
@@ -120,13 +190,13 @@ void scan_flux(TrackData& trackdata)
 // Scan a track bitstream for sectors
 void scan_bitstream(TrackData& trackdata)
 {
-    static Encoding last_encoding = Encoding::MFM;
+    static thread_local Encoding last_encoding = Encoding::MFM;
 
     std::vector<Encoding> encodings;
-    if (opt.encoding != Encoding::Unknown)
+    if (RequestedEncoding() != Encoding::Unknown)
     {
         // Just the one requested format.
-        encodings = { opt.encoding };
+        encodings = { RequestedEncoding() };
     }
     else
     {
@@ -583,6 +653,8 @@ void scan_bitstream_gcr(TrackData& trackdata)
         }
     }
 
+    Data data;
+
     // Process each sector header to look for an associated data field
     for (auto it = track.begin(); it != track.end(); ++it)
     {
@@ -658,7 +730,7 @@ void scan_bitstream_gcr(TrackData& trackdata)
             }
 
             // Read the full data field and verify its checksum
-            Data data(data_bytes);
+            data.resize(data_bytes);
             bitbuf.read(data);
             stored_cksum = data[256];
 
@@ -1245,6 +1317,16 @@ void scan_bitstream_mfm_fm(TrackData& trackdata)
         }
     }
 
+    Data data;
+
+    // Data field track offsets in order, so each header need only consider those in reach
+    std::vector<std::pair<int, int>> dam_positions;     // track offset, data_fields index
+    dam_positions.reserve(data_fields.size());
+    for (auto i = 0; i < static_cast<int>(data_fields.size()); ++i)
+        dam_positions.emplace_back(bitbuf.track_offset(data_fields[i].first), i);
+    std::sort(dam_positions.begin(), dam_positions.end());
+    std::vector<int> candidates;
+
     // Process each sector header to look for an associated data field
     for (auto it = track.begin(); it != track.end(); ++it)
     {
@@ -1263,8 +1345,21 @@ void scan_bitstream_mfm_fm(TrackData& trackdata)
         if (opt.debug)
             util::cout << "  s_b_mfm_fm finding " << trackdata.cylhead << " sector " << sector.header.sector << ":\n";
 
-        for (auto itData = data_fields.begin(); itData != data_fields.end(); ++itData)
+        // Gather the data fields within reach of the header, allowing for track wrap,
+        // and check them in the order they were found.
+        candidates.clear();
+        for (auto base : { sector.offset, sector.offset - track.tracklen })
         {
+            auto itPos = std::lower_bound(dam_positions.begin(), dam_positions.end(), std::make_pair(base + min_distance, 0));
+            for (; itPos != dam_positions.end() && itPos->first <= base + max_distance; ++itPos)
+                candidates.push_back(itPos->second);
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        for (auto idx : candidates)
+        {
+            auto itData = data_fields.begin() + idx;
             const auto& dam_offset = itData->first;
             const Encoding& data_encoding = itData->second;
             auto itDataNext = (std::next(itData) == data_fields.end()) ? data_fields.begin() : std::next(itData);
@@ -1340,7 +1435,7 @@ void scan_bitstream_mfm_fm(TrackData& trackdata)
             }
 
             // Read the full data field and check its CRC
-            Data data(data_bytes);
+            data.resize(data_bytes);
             bitbuf.read(data);
             bool bad_crc = crc.add(data.data(), normal_bytes) != 0;
             if (opt.debug && bad_crc)
@@ -1573,6 +1668,8 @@ void scan_bitstream_agat(TrackData& trackdata)
         }
     }
 
+    Data data;
+
     // Process each sector header to look for an associated data field
     for (auto it = track.begin(); it != track.end(); ++it)
     {
@@ -1643,7 +1740,7 @@ void scan_bitstream_agat(TrackData& trackdata)
             }
 
             // Read the full data field and verify its checksum
-            Data data(data_bytes);
+            data.resize(data_bytes);
             bitbuf.read(data);
             cksum = 0;
             stored_cksum = data[256];
@@ -1835,6 +1932,8 @@ void scan_bitstream_victor(TrackData& trackdata)
         }
     }
 
+    Data data;
+
     // Process each sector header to look for an associated data field
     for (auto it = track.begin(); it != track.end(); ++it)
     {
@@ -1910,7 +2009,7 @@ void scan_bitstream_victor(TrackData& trackdata)
             }
 
             // Read the full data field and verify its checksum
-            Data data(data_bytes);
+            data.resize(data_bytes);
             bitbuf.read(data);
 
             stored_cksum = bitbuf.read_byte();
@@ -3,12 +3,14 @@
 #include "SAMdisk.h"
 #include "BitstreamEncoder.h"
 #include "BitstreamTrackBuilder.h"
+#include "FluxTrackBuilder.h"
 #include "SpecialFormat.h"
 #include "IBMPC.h"
 
 bool generate_special(TrackData& trackdata)
 {
-    auto track{ trackdata.track() };
+    // Each generator builds a new TrackData from the track before it's added
+    auto& track = trackdata.track();
     int weak_offset{ 0 }, weak_size{ 0 };
 
     // Special formats have special conversions
@@ -129,50 +131,119 @@ void generate_bitstream(TrackData& trackdata)
         throw util::exception("bitstream conversion not yet implemented for ", trackdata.cylhead);
 }
 
-void generate_flux(TrackData& trackdata)
+// Position of the lowest set bit in a non-zero value
+static inline int LowestSetBit(uint64_t value)
 {
-    uint8_t last_bit{ 0 }, curr_bit{ 0 };
-    auto& bitbuf = trackdata.bitstream();
+#if defined(__GNUC__)
+    return __builtin_ctzll(value);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#else
+    auto index = 0;
+    for (; !(value & 1); value >>= 1)
+        ++index;
+    return index;
+#endif
+}
+
+static FluxData bitstream_to_flux(const BitBuffer& bitbuf, bool pre_comp)
+{
+    auto& data = bitbuf.data();
+    auto bitsize = bitbuf.size();
     auto ns_per_bitcell = bitcell_ns(bitbuf.datarate);
-    bitbuf.seek(0);
 
-    uint32_t flux_time{ 0 };
+    // Write precompensation by neighbouring bits (previous, next), moving
+    // adjacent transitions further apart to account for attraction when written.
+    static const int pre_comp_table[4]{ 0, -FluxTrackBuilder::PRECOMP_NS, +FluxTrackBuilder::PRECOMP_NS, 0 };
+
+    auto bit_at = [&](int pos) {
+        return (pos >= 0 && pos < bitsize) ? (data[pos >> 3] >> (pos & 7)) & 1 : 0;
+    };
+
+    // Revolutions end at each index position within the bitstream
+    std::vector<int> rev_ends;
+    for (auto index : bitbuf.indexes())
+    {
+        if (index > 0 && index < bitsize && (rev_ends.empty() || index > rev_ends.back()))
+            rev_ends.push_back(index);
+    }
+    auto itRevEnd = rev_ends.begin();
+
     FluxData flux_data{};
     std::vector<uint32_t> flux_times{};
-    flux_times.reserve(bitbuf.size());
+    flux_times.reserve(bitsize / 2);
+
+    // Each 1 bit is a reversal, timed from the previous one to the end of
+    // the following bit cell, so the final bit can't complete a reversal.
+    auto last_end = 0;
+    uint32_t carry_ns{ 0 };
+    auto last_bits = std::max(bitsize - 1, 0);
 
-    while (!bitbuf.wrapped())
+    for (auto base = 0; base < last_bits; base += 64)
     {
-        auto next_bit{ bitbuf.read1() };
+        // Gather the next 64 bits, stored least significant first
+        uint64_t word{ 0 };
+        auto word_bytes = std::min(8, static_cast<int>(data.size()) - (base >> 3));
+        std::memcpy(&word, data.data() + (base >> 3), word_bytes);
+        word = util::letoh(word);
 
-        flux_time += ns_per_bitcell;
-        if (curr_bit)
+        if (last_bits - base < 64)
+            word &= (uint64_t(1) << (last_bits - base)) - 1;
+
+        while (word)
         {
-            if (trackdata.cylhead.cyl < 40)
-            {
-                flux_times.push_back(flux_time);
-                flux_time = 0;
-            }
-            else
+            auto pos = base + LowestSetBit(word);
+            word &= word - 1;
+
+            // Complete any revolutions ending before this reversal
+            auto end = pos + 2;
+            for (; itRevEnd != rev_ends.end() && end > *itRevEnd; ++itRevEnd)
             {
-                auto pre_comp_ns{ (last_bit == next_bit) ? 0 : (last_bit ? +240 : -240) };
-                flux_times.push_back(flux_time + pre_comp_ns);
-                flux_time = 0 - pre_comp_ns;
+                flux_data.push_back(std::move(flux_times));
+                flux_times.clear();
             }
-        }
 
-        last_bit = curr_bit;
-        curr_bit = next_bit;
-
-        if (bitbuf.index())
-        {
-            flux_data.push_back(std::move(flux_times));
-            flux_times.clear();
+            auto pre_comp_ns = pre_comp ? pre_comp_table[(bit_at(pos - 1) << 1) | bit_at(pos + 1)] : 0;
+            flux_times.push_back(static_cast<uint32_t>((end - last_end) * ns_per_bitcell) + carry_ns + pre_comp_ns);
+            carry_ns = 0 - pre_comp_ns;
+            last_end = end;
         }
     }
 
+    for (; itRevEnd != rev_ends.end(); ++itRevEnd)
+    {
+        flux_data.push_back(std::move(flux_times));
+        flux_times.clear();
+    }
+
     if (flux_data.empty() || !flux_times.empty())
         flux_data.push_back(std::move(flux_times));
 
-    trackdata.add(std::move(flux_data), true);
+    return flux_data;
+}
+
+void generate_flux(TrackData& trackdata)
+{
+    auto& bitbuf = trackdata.bitstream();
+    auto pre_comp = trackdata.cylhead.cyl >= 40;
+
+    if (!IsEmptyTrackBitstream(bitbuf))
+    {
+        trackdata.add(bitstream_to_flux(bitbuf, pre_comp), true);
+        return;
+    }
+
+    // Empty tracks share the flux generated from their canonical bitstream
+    static std::mutex cache_mutex;
+    static std::map<std::tuple<DataRate, Encoding, int, bool>, FluxData> cache;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto key = std::make_tuple(bitbuf.datarate, bitbuf.encoding, bitbuf.size(), pre_comp);
+    auto it = cache.find(key);
+    if (it == cache.end())
+        it = cache.emplace(key, bitstream_to_flux(bitbuf, pre_comp)).first;
+
+    trackdata.add(FluxData(it->second), true);
 }
@@ -17,6 +17,10 @@ int BitstreamTrackBuilder::size() const
 
 void BitstreamTrackBuilder::setEncoding(Encoding encoding)
 {
+    // Bytes logged in a different encoding wouldn't decode the same.
+    if (encoding != m_buffer.encoding)
+        m_bytes.clear();
+
     TrackBuilder::setEncoding(encoding);
     m_buffer.encoding = encoding;
 }
@@ -24,21 +28,40 @@ void BitstreamTrackBuilder::setEncoding(Encoding encoding)
 void BitstreamTrackBuilder::addRawBit(bool bit)
 {
     m_buffer.add(bit);
+    m_bytes.clear();
 }
 
-void BitstreamTrackBuilder::addCrc(int size)
+void BitstreamTrackBuilder::addEncodedByte(uint8_t byte, uint32_t bits, int count)
 {
-    auto old_bitpos{ m_buffer.tell() };
-    auto byte_bits{ (m_buffer.encoding == Encoding::FM) ? 32 : 16 };
-    assert(old_bitpos >= size * byte_bits);
-    m_buffer.seek(old_bitpos - size * byte_bits);
+    if (m_buffer.tell() != m_bytes_end)
+        m_bytes.clear();
 
+    m_buffer.add_bits(bits, count);
+    m_bytes.push_back(byte);
+    m_bytes_end = m_buffer.tell();
+}
+
+void BitstreamTrackBuilder::addCrc(int size)
+{
     CRC16 crc{};
-    while (size-- > 0)
-        crc.add(m_buffer.read_byte());
 
-    // Seek back to the starting position to write the CRC.
-    m_buffer.seek(old_bitpos);
+    // Use the logged bytes if they cover the CRC block, otherwise decode it.
+    if (m_buffer.tell() == m_bytes_end && static_cast<int>(m_bytes.size()) >= size)
+        crc.add(m_bytes.data() + m_bytes.size() - size, size);
+    else
+    {
+        auto old_bitpos{ m_buffer.tell() };
+        auto byte_bits{ (m_buffer.encoding == Encoding::FM) ? 32 : 16 };
+        assert(old_bitpos >= size * byte_bits);
+        m_buffer.seek(old_bitpos - size * byte_bits);
+
+        while (size-- > 0)
+            crc.add(m_buffer.read_byte());
+
+        // Seek back to the starting position to write the CRC.
+        m_buffer.seek(old_bitpos);
+    }
+
     addByte(crc >> 8);
     addByte(crc & 0xff);
 }
@@ -16,17 +16,58 @@ void DemandDisk::extend(const CylHead& cylhead)
 
 bool DemandDisk::supports_retries() const
 {
-    // We only support full track rescans rather than individual sector retries.
+    // Retries are handled here by merging sectors from fresh captures.
     return false;
 }
 
+// Merge sectors from a retry capture that are missing or bad in the current
+// track, leaving good sectors alone.
+void DemandDisk::merge_retry(TrackData& trackdata, TrackData&& retry_trackdata)
+{
+    auto& track = trackdata.track();
+    auto& retry_track = retry_trackdata.track();
+
+    // Without sector positions we can't safely match sectors between
+    // captures, so fall back to using the capture with the most sectors.
+    // The same applies if the new capture was decoded at a different rate.
+    auto unpositioned = std::any_of(retry_track.begin(), retry_track.end(),
+        [](const Sector& s) { return s.offset == 0; });
+    auto rate_change = !track.empty() && !retry_track.empty() &&
+        track[0].datarate != retry_track[0].datarate;
+    if (unpositioned || rate_change)
+    {
+        if (retry_track.size() > track.size())
+            std::swap(trackdata, retry_trackdata);
+        return;
+    }
+
+    Track fixes;
+    fixes.tracklen = retry_track.tracklen;
+    fixes.tracktime = retry_track.tracktime;
+
+    Track::HeaderIndex index(track);
+    for (auto& sector : retry_track.sectors())
+    {
+        // Skip sectors we already hold good data for.
+        auto idx = index.find(sector.header, sector.datarate, sector.encoding);
+        if (idx >= 0 && track[idx].has_good_data() && !track[idx].is_8k_sector())
+            continue;
+
+        if (!sector.has_badidcrc())
+            fixes.add(Sector(sector));
+    }
+
+    // Track::add() matches sectors by header and position, so retried
+    // sectors merge with their originals and missing ones are inserted.
+    trackdata.add(std::move(fixes));
+}
+
 const TrackData& DemandDisk::read(const CylHead& cylhead, bool uncached)
 {
     if (uncached || !m_loaded[cylhead])
     {
-        // Quick first read, plus sector-based conversion
+        // Quick first read, with sector conversion only if needed below
         auto trackdata = load(cylhead, true);
-        auto& track = trackdata.track();
 
         // If the disk supports sector-level retries we won't duplicate them.
         auto retries = supports_retries() ? 0 : opt.retries;
@@ -36,18 +77,15 @@ const TrackData& DemandDisk::read(const CylHead& cylhead, bool uncached)
         while (rescans > 0 || retries > 0)
         {
             // If no more rescans are required, stop when there's nothing to fix.
-            if (rescans <= 0 && track.has_good_data())
+            if (rescans <= 0 && trackdata.track().has_good_data())
                 break;
 
+            // Merge any new or repaired sectors into what we already have.
             auto rescan_trackdata = load(cylhead);
-            auto& rescan_track = rescan_trackdata.track();
-
-            // If the rescan found more sectors, use the new track data.
-            if (rescan_track.size() > track.size())
-                std::swap(trackdata, rescan_trackdata);
+            auto revs = rescan_trackdata.has_flux() ? REMAIN_READ_REVS : 1;
+            merge_retry(trackdata, std::move(rescan_trackdata));
 
             // Flux reads include 5 revolutions, others just 1
-            auto revs = trackdata.has_flux() ? REMAIN_READ_REVS : 1;
             rescans -= revs;
             retries -= revs;
         }
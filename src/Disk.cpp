@@ -57,6 +57,62 @@ bool Disk::preload(const Range& range_, int cyl_step)
     return true;
 }
 
+// Convert every track to the form an image writer needs, so the writer
+// itself only has to serialise the data.
+bool Disk::preencode(PreferredData data)
+{
+    if (!opt.mt || ThreadPool::get_thread_count() <= 1)
+        return false;
+
+    std::vector<CylHead> cylheads;
+    {
+        std::lock_guard<std::mutex> lock(m_trackdata_mutex);
+        for (auto& p : m_trackdata)
+            cylheads.push_back(p.first);
+    }
+
+    ThreadPool pool;
+    std::vector<std::future<void>> rets;
+
+    for (auto& cylhead : cylheads)
+    {
+        rets.push_back(pool.enqueue([this, cylhead, data]() {
+            read(cylhead);
+
+            // Each task owns a different track, so the conversion can run
+            // outside the lock, which only guards the map itself.
+            TrackData* trackdata;
+            {
+                std::lock_guard<std::mutex> lock(m_trackdata_mutex);
+                trackdata = &m_trackdata[cylhead];
+            }
+
+            if (!trackdata->has_track() && !trackdata->has_bitstream() && !trackdata->has_flux())
+                return;
+
+            switch (data)
+            {
+            case PreferredData::Track:
+                trackdata->track();
+                break;
+            case PreferredData::Bitstream:
+                trackdata->bitstream();
+                break;
+            case PreferredData::Flux:
+                trackdata->flux();
+                break;
+            case PreferredData::Unknown:
+                break;
+            }
+            }));
+    }
+
+    for (auto& ret : rets)
+        ret.get();
+
+    return true;
+}
+
 void Disk::clear()
 {
     m_trackdata.clear();
@@ -2,6 +2,7 @@
 
 #include "SAMdisk.h"
 #include "DiskUtil.h"
+#include "RegularDisk.h"
 #include "SpecialFormat.h"
 #include "TrackDataParser.h"
 
@@ -28,6 +29,8 @@ void DumpTrack(const CylHead& cylhead, const Track& track, const ScanContext& co
         util::cout << colour::grey << "<blank>" << colour::none;
     else
     {
+        Track::HeaderIndex index(track);
+
         for (auto& sector : track.sectors())
         {
             util::cout << RecordStr(sector.header.sector);
@@ -84,7 +87,7 @@ void DumpTrack(const CylHead& cylhead, const Track& track, const ScanContext& co
                 util::cout << colour::RED << "dc" << colour::none;  // Data field CRC error
             }
 
-            if (track.is_repeated(sector))
+            if (index.is_repeated(sector))
             {
                 item_separator(items++);
                 util::cout << colour::YELLOW << "r" << colour::none;    // Repeated sector
@@ -491,7 +494,7 @@ bool NormaliseTrack(const CylHead& cylhead, Track& track)
                     // Are we to fix (disable) the protection?
                     if (opt.fix == 1)
                     {
-                        data[i + 3] = 0xaf; // XOR A
+                        s.writable_data_copy()[i + 3] = 0xaf; // XOR A
                         Message(msgFix, "disabled problematic Reussir protection");
                     }
                     else
@@ -601,12 +604,20 @@ bool NormaliseBitstream(BitBuffer& bitbuf)
 bool RepairTrack(const CylHead& cylhead, Track& track, const Track& src_track)
 {
     bool changed = false;
+    Track::HeaderIndex src_index(src_track);
+    Track::HeaderIndex index(track);
+
+    // Missing sectors are added after the loop, so the index stays valid.
+    // Source sectors aren't repeated, so none would match an added sector.
+    std::vector<std::pair<int, Sector>> missing;
 
     // Loop over all source sectors available.
-    for (auto src_sector : src_track)
+    for (auto idx_src = 0; idx_src < src_track.size(); ++idx_src)
     {
+        auto src_sector = src_track[idx_src];
+
         // Skip repeated source sectors, as the data source is ambiguous.
-        if (src_track.is_repeated(src_sector))
+        if (src_index.is_repeated(src_sector))
             continue;
 
         // In real-world use 250Kbps/300Kbps are interchangeable due to 300rpm/360rpm.
@@ -619,11 +630,13 @@ bool RepairTrack(const CylHead& cylhead, Track& track, const Track& src_track)
         }
 
         // Find a target sector with the same CHRN, datarate, and encoding.
-        auto it = track.find(src_sector.header, src_sector.datarate, src_sector.encoding);
-        if (it != track.end())
+        auto idx = index.find(src_sector.header, src_sector.datarate, src_sector.encoding);
+        if (idx >= 0)
         {
+            auto it = track.begin() + idx;
+
             // Skip repeated target sectors, as the repair target is ambiguous.
-            if (track.is_repeated(*it))
+            if (index.is_repeated(*it))
                 continue;
 
             // Merge the two sectors to give the best version.
@@ -642,27 +655,34 @@ bool RepairTrack(const CylHead& cylhead, Track& track, const Track& src_track)
             auto insert_idx = track.size();
 
             // Loop over sectors appearing after the current sector on the source track.
-            auto idx_src = src_track.index_of(src_sector);
             for (int i = idx_src + 1; i < src_track.size(); ++i)
             {
                 auto& s = src_track[i];
 
                 // Attempt to find the same sector on the target track.
-                it = track.find(s.header, s.datarate, s.encoding);
-                if (it != track.end())
+                idx = index.find(s.header, s.datarate, s.encoding);
+                if (idx >= 0)
                 {
                     // The missing sector must appear before the match we just found.
-                    insert_idx = track.index_of(*it);
+                    insert_idx = idx;
                     break;
                 }
             }
 
             Message(msgFix, "added missing %s", CHR(cylhead.cyl, cylhead.head, src_sector.header.sector));
-            track.insert(insert_idx, std::move(src_sector));
+            missing.emplace_back(insert_idx, std::move(src_sector));
             changed = true;
         }
     }
 
+    // Insert in position order, keeping source order for the same position
+    std::stable_sort(missing.begin(), missing.end(),
+        [](const std::pair<int, Sector>& a, const std::pair<int, Sector>& b) { return a.first < b.first; });
+
+    auto inserted = 0;
+    for (auto& p : missing)
+        track.insert(p.first + inserted++, std::move(p.second));
+
     return changed;
 }
 
@@ -833,28 +853,46 @@ bool WriteRegularDisk(FILE* f_, Disk& disk, const Format& fmt)
 {
     auto missing = 0;
 
+    // Untouched regular images are written straight from the image data
+    auto regular_disk = dynamic_cast<RegularDisk*>(&disk);
+    if (regular_disk && !regular_disk->pristine())
+        regular_disk = nullptr;
+
     fmt.range().each([&](const CylHead& cylhead) {
-        const auto& track = disk.read_track(cylhead);
+        Data buf(fmt.track_size(), fmt.fill);
+        auto pb = buf.data();
         Header header(cylhead, 0, fmt.size);
 
-        for (header.sector = fmt.base; header.sector < fmt.base + fmt.sectors; ++header.sector)
+        const Track* track = regular_disk ? nullptr : &disk.read_track(cylhead);
+
+        for (header.sector = fmt.base; header.sector < fmt.base + fmt.sectors; ++header.sector, pb += fmt.sector_size())
         {
-            Data buf(fmt.sector_size(), fmt.fill);
+            if (regular_disk)
+            {
+                auto bytes = 0;
+                auto pbData = regular_disk->sector_data(header, bytes);
+                if (pbData)
+                    std::copy(pbData, pbData + bytes, pb);
+                else
+                    missing++;
 
-            auto it = track.find(header);
-            if (it != track.end() && (*it).has_data())
+                continue;
+            }
+
+            auto it = track->find(header);
+            if (it != track->end() && (*it).has_data())
             {
                 const auto& data = (*it).data_copy();
-                std::copy(data.begin(), data.begin() + std::min(data.size(), buf.size()), buf.begin());
+                std::copy(data.begin(), data.begin() + std::min(data.size(), fmt.sector_size()), pb);
             }
             else
             {
                 missing++;
             }
-
-            if (!fwrite(buf.data(), buf.size(), 1, f_))
-                throw util::exception("write error, disk full?");
         }
+
+        if (!fwrite(buf.data(), buf.size(), 1, f_))
+            throw util::exception("write error, disk full?");
         }, fmt.cyls_first);
 
     if (missing && !opt.minimal)
@@ -1079,65 +1117,67 @@ bool test_remove_gap4b(const Data& data, int offset)
 }
 
 
-// Attempt to determine the 8K checksum method for a given data block
-std::set<ChecksumType> ChecksumMethods(const uint8_t* buf, int len)
+// Determine the 8K checksum methods matching a data block, in a single pass
+static std::set<ChecksumType> ScanChecksumMethods(const uint8_t* buf, int len)
 {
+    // All the CRC methods start with the same data, so one CRC is shared and its
+    // value checked at each of their lengths. CRC-16 is linear, so the 92FD CRC
+    // is the D2F6 CRC adjusted by the CRC of their init difference over zeros.
+    static const uint16_t crc_92fd_adjust = CRC16(0x92fd ^ 0xd2f6).add(0, 0x1602);
+
     std::set<ChecksumType> methods;
+    CRC16 crc(0xd2f6);
+    uint8_t sum = 0, xor_ = 0;
+    auto filler = true;
+
+    for (auto i = 0; i < std::min(len, 0x1800); ++i)
+    {
+        auto b = buf[i];
+        crc.add(b);
+        sum += b;
+        xor_ ^= b;
+        filler &= (b == buf[0]);
+
+        // Check for CRC-16 of the first 0x1602 bytes, using a custom CRC init of 92FD.
+        // This is known to be used by Terminator 2: Judgment Day (+3).
+        if (i == 0x1601 && crc == crc_92fd_adjust)
+            methods.insert(ChecksumType::CRC_92FD_1602);
+    }
 
     // 2-byte CRC
+    if (len >= 0x1802)
     {
-        // Check for CRC of 8C 15, which seems to be a strange fixed checksum found on some disks.
+        // Check for CRC-16 of the first 0x1800 bytes, using a custom CRC init of D2F6.
+        // This is known to be used by JPP's Goal Busters (CPC).
+        if (!crc.add(buf + 0x1800, 2)) // include CRC bytes
+            methods.insert(ChecksumType::CRC_D2F6_1800);
+
+        // Check for a CRC of 8C 15, which seems to be a strange fixed checksum found on some disks.
         // This is known to be used by The Cycles (+3), Vigilante (CPC), and Les Hits de Noel (CPC).
         if (len >= 0x1803 && buf[0x1800] == 0x8c && buf[0x1801] == 0x15)
             methods.insert(ChecksumType::Constant_8C15);
 
-        // Calculate the CRC-16 of the first 0x1800 bytes, using a custom CRC init of D2F6.
-        // This is known to be used by JPP's Goal Busters (CPC).
-        if (len >= 0x1802)
-        {
-            CRC16 crc(buf, 0x1800 + 2, 0xd2f6); // include CRC bytes
-            if (!crc)
-                methods.insert(ChecksumType::CRC_D2F6_1800);
-        }
-
-        // Calculate the CRC-16 of the first 0x1802 bytes, using a custom CRC init of D2F6.
+        // Check for CRC-16 of the first 0x1802 bytes, using a custom CRC init of D2F6.
         // This is known to be used by Les Fous du Foot (CPC).
-        if (len >= 0x1804)
-        {
-            CRC16 crc(buf, 0x1802 + 2, 0xd2f6); // include CRC bytes
-            if (!crc)
-                methods.insert(ChecksumType::CRC_D2F6_1802);
-        }
-
-        // Calculate the CRC-16 of the first 0x1602 bytes, using a custom CRC init of 92FD.
-        // This is known to be used by Terminator 2: Judgment Day (+3).
-        if (len >= 0x1602)
-        {
-            CRC16 crc(buf, 0x1600 + 2, 0x92fd); // include CRC bytes
-            if (!crc)
-                methods.insert(ChecksumType::CRC_92FD_1602);
-        }
+        if (len >= 0x1804 && !crc.add(buf + 0x1802, 2)) // include CRC bytes
+            methods.insert(ChecksumType::CRC_D2F6_1802);
     }
 
     // 1-byte checksum
     if (len >= 0x1800)
     {
         // Sum the first 6K
-        auto sum = static_cast<uint8_t>(std::accumulate(buf, buf + 0x1800, 0));
         if (buf[0x1800] == sum)
             methods.insert(ChecksumType::Sum_1800);
 
         // XOR together the first 6K
-        auto xor_ = static_cast<uint8_t>(
-            std::accumulate(buf, buf + 0x1800, 0, std::bit_xor<int>()));
         if (buf[0x1800] == xor_)
             methods.insert(ChecksumType::XOR_1800);
 
         if (len >= 0x18a0)
         {
             // Extend the XOR to 0x18a0 bytes, as needed for Coin-Op Hits
-            xor_ = static_cast<uint8_t>(
-                std::accumulate(buf + 0x1800, buf + 0x18a0, xor_, std::bit_xor<uint8_t>()));
+            xor_ = std::accumulate(buf + 0x1800, buf + 0x18a0, xor_, std::bit_xor<uint8_t>());
             if (buf[0x18a0] == xor_)
                 methods.insert(ChecksumType::XOR_18A0);
         }
@@ -1145,12 +1185,68 @@ std::set<ChecksumType> ChecksumMethods(const uint8_t* buf, int len)
 
     // Check 6K of filler on unused tracks (Vigilante on CPC)
     // This is only done if we haven't yet matched another method.
-    if (methods.empty() && len >= 0x1800 && !memcmp(buf, buf + 1, 0x17ff))
+    if (methods.empty() && len >= 0x1800 && filler)
         methods.insert(ChecksumType::None);
 
     return methods;
 }
 
+// Quick 64-bit hash of a data block, reading a word at a time
+static uint64_t BlockHash(const uint8_t* buf, int len)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL ^ static_cast<uint64_t>(len);
+    auto i = 0;
+
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, buf + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+        hash ^= hash >> 29;
+    }
+
+    for (; i < len; ++i)
+        hash = (hash ^ buf[i]) * 0x100000001b3ULL;
+
+    return hash;
+}
+
+// Attempt to determine the 8K checksum method for a given data block
+std::set<ChecksumType> ChecksumMethods(const uint8_t* buf, int len)
+{
+    // Too short for any method?
+    if (len < 0x1602)
+        return {};
+
+    // No method looks beyond 0x18a1 bytes, so longer blocks give the same result
+    len = std::min(len, 0x18a1);
+
+    // The same data is checked repeatedly as a track is merged, normalised
+    // and listed, so remember the results for the most recent blocks. They're
+    // found by a hash of the data, which is much cheaper than the scan.
+    struct CachedMethods
+    {
+        uint64_t hash = 0;
+        int len = 0;
+        std::set<ChecksumType> methods{};
+    };
+    static thread_local std::array<CachedMethods, 4> cache;
+    static thread_local size_t cache_next;
+
+    auto hash = BlockHash(buf, len);
+    for (auto& entry : cache)
+    {
+        if (entry.len == len && entry.hash == hash)
+            return entry.methods;
+    }
+
+    auto& entry = cache[cache_next++ % cache.size()];
+    entry.hash = hash;
+    entry.len = len;
+    entry.methods = ScanChecksumMethods(buf, len);
+    return entry.methods;
+}
+
 std::string ChecksumName(std::set<ChecksumType> methods)
 {
     std::stringstream ss;
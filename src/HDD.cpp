@@ -5,7 +5,17 @@
 #include "BlockDevice.h"
 #include "HDFHDD.h"
 
+#include <condition_variable>
+#include <queue>
+
+#ifdef HAVE_LINUX_FS_H
+#include <linux/fs.h>       // BLKZEROOUT, BLKDISCARD
+#endif
+
 #define SECTOR_BLOCK    2048    // access CF/HDD devices in 1MB chunks
+#define COPY_BUFFERS    4       // blocks in flight during HDD copies
+
+constexpr auto PROGRESS_INTERVAL = std::chrono::milliseconds(250);
 
 
 /*static*/ bool HDD::IsRecognised(const std::string& path)
@@ -213,57 +223,536 @@ bool HDD::SafetyCheck()
 }
 
 
+// Clear a range of sectors without writing data, if the target supports it.
+// Regular files have holes punched, and block devices use a zero-out request.
+bool HDD::Zero(int64_t sector, int64_t count)
+{
+    auto offset = sector * sector_size + data_offset;
+    auto len = count * sector_size;
+
+#ifndef _WIN32
+    struct stat st {};
+    if (fstat(h, &st) != 0)
+        return false;
+
+    if (S_ISREG(st.st_mode))
+    {
+#if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_PUNCH_HOLE)
+        return fallocate(h, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, len) == 0;
+#endif
+    }
+    else if (S_ISBLK(st.st_mode))
+    {
+#ifdef BLKZEROOUT
+        uint64_t range[2] = { static_cast<uint64_t>(offset), static_cast<uint64_t>(len) };
+        return ioctl(h, BLKZEROOUT, range) == 0;
+#endif
+    }
+#else
+    (void)offset;
+    (void)len;
+#endif
+
+    return false;
+}
+
+// Tell a block device the sector range is unused. The contents afterwards
+// are device-specific, so this must be followed by writing the real data.
+bool HDD::Discard(int64_t sector, int64_t count)
+{
+#if defined(BLKDISCARD) && !defined(_WIN32)
+    struct stat st {};
+    if (fstat(h, &st) != 0 || !S_ISBLK(st.st_mode))
+        return false;
+
+    uint64_t range[2] = {
+        static_cast<uint64_t>(sector * sector_size + data_offset),
+        static_cast<uint64_t>(count * sector_size) };
+    return ioctl(h, BLKDISCARD, range) == 0;
+#else
+    (void)sector;
+    (void)count;
+    return false;
+#endif
+}
+
+
+// A block of sectors passed from the copy reader to the writer
+struct COPY_BLOCK
+{
+    explicit COPY_BLOCK(int size) : mem(size) {}
+
+    MEMORY mem;
+    int64_t pos = 0;            // offset from start of copy, in sectors
+    int sectors = 0;            // sectors of valid data
+    int bad_sector = -1;        // index of zero-filled unreadable sector
+    std::string error{};        // read error description
+};
+
 bool HDD::Copy(HDD* phSrc_, int64_t uSectors_, int64_t uSrcOffset_/*=0*/, int64_t uDstOffset_/*=0*/, int64_t uTotal_/*=0*/, const char* pcszAction_)
 {
-    MEMORY mem(SECTOR_BLOCK * sector_size);
+    auto block_sectors = opt.blocksize > 0 ? std::max(1, opt.blocksize * 1024 / sector_size) : SECTOR_BLOCK;
 
     if (!uTotal_) uTotal_ = uSectors_;
 
-    for (int64_t uPos = 0;;)
+    // Limit status updates to a few per second, as they're costly on some consoles
+    auto last_status = std::chrono::steady_clock::now() - PROGRESS_INTERVAL;
+    auto status = [&](int64_t uPos, bool force = false) {
+        auto now = std::chrono::steady_clock::now();
+        if (force || now - last_status >= PROGRESS_INTERVAL)
+        {
+            Message(msgStatus, "%s... %d%%", pcszAction_ ? pcszAction_ : "Copying",
+                static_cast<int>((static_cast<uint64_t>(uDstOffset_ + uPos) * 100 / uTotal_)));
+            last_status = now;
+        }
+    };
+
+    // Zero ranges are cleared without writing, where the target supports it
+    auto can_zero = true;
+
+    // Write a block to the target, skipping over any write errors
+    auto write_block = [&](COPY_BLOCK& block, bool zero_filled) {
+        if (zero_filled && can_zero)
+        {
+            if (Zero(uDstOffset_ + block.pos, block.sectors))
+                return;
+
+            can_zero = false;
+        }
+
+        for (auto done = 0; done < block.sectors; )
+        {
+            auto uBlock = block.sectors - done;
+
+            Seek(uDstOffset_ + block.pos + done);
+            auto uWritten = Write(block.mem + (done * sector_size), uBlock);
+            if (uWritten != uBlock)
+            {
+                Message(msgStatus, "Write error at sector %lu: %s", uDstOffset_ + block.pos + done + uWritten, LastError());
+
+                // Skip past the write error
+                ++uWritten;
+            }
+
+            done += uWritten;
+        }
+    };
+
+    // Without a source we're just clearing the target area
+    if (!phSrc_)
     {
-        // Sync source and destinations
-        if (phSrc_) phSrc_->Seek(uSrcOffset_ + uPos);
-        Seek(uDstOffset_ + uPos);
+        COPY_BLOCK block(block_sectors * sector_size);
+
+        for (int64_t uPos = 0; uPos < uSectors_; uPos += block.sectors)
+        {
+            status(uPos);
+
+            block.pos = uPos;
+            block.sectors = static_cast<int>(std::min<int64_t>(uSectors_ - uPos, block_sectors));
+            write_block(block, true);
+        }
+
+        status(uSectors_, true);
+        return true;
+    }
 
-        // Determine how much to transfer in one go
-        if (uPos > uSectors_) uPos = uSectors_;
-        auto uBlock = std::min(static_cast<int>(uSectors_ - uPos), SECTOR_BLOCK);
+    // Several blocks are kept in flight, so reading from the source overlaps
+    // writing to the target. Blocks cycle between the free and full queues.
+    std::vector<std::unique_ptr<COPY_BLOCK>> blocks;
+    std::queue<COPY_BLOCK*> free_blocks, full_blocks;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool abort = false;
 
-        Message(msgStatus, "%s... %d%%", pcszAction_ ? pcszAction_ : "Copying",
-            static_cast<int>((static_cast<uint64_t>(uDstOffset_ + uPos) * 100 / uTotal_)));
+    for (auto i = 0; i < COPY_BUFFERS; ++i)
+    {
+        blocks.push_back(std::make_unique<COPY_BLOCK>(block_sectors * sector_size));
+        free_blocks.push(blocks.back().get());
+    }
+
+    std::thread reader([&]() {
+        for (int64_t uPos = 0; uPos < uSectors_; )
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&] { return abort || !free_blocks.empty(); });
+            if (abort)
+                return;
+
+            auto block = free_blocks.front();
+            free_blocks.pop();
+            lock.unlock();
+
+            auto uBlock = static_cast<int>(std::min<int64_t>(uSectors_ - uPos, block_sectors));
+
+            phSrc_->Seek(uSrcOffset_ + uPos);
+            auto uRead = phSrc_->Read(block->mem, uBlock);
+
+            block->bad_sector = -1;
+            if (uRead != uBlock)
+            {
+                block->bad_sector = uRead;
+                block->error = LastError();
+
+                // Clear the bad block, but include it in the read data
+                memset(block->mem + (uRead * sector_size), 0, sector_size);
+                ++uRead;
+            }
+
+            // Forced byte-swapping?
+            if (opt.byteswap)
+                ByteSwap(block->mem, uRead * sector_size);
+
+            block->pos = uPos;
+            block->sectors = uRead;
+            uPos += uRead;
+
+            lock.lock();
+            full_blocks.push(block);
+            cond.notify_all();
+        }
 
-        if (!uBlock)
-            break;
+        // Signal the end of the source data
+        std::lock_guard<std::mutex> lock(mutex);
+        full_blocks.push(nullptr);
+        cond.notify_all();
+        });
 
-        // Read from source disk
-        auto uRead = phSrc_ ? phSrc_->Read(mem, uBlock) : uBlock;
-        if (uRead != uBlock)
+    try
+    {
+        for (;;)
         {
-            Message(msgStatus, "Read error at sector %lu: %s", uSrcOffset_ + uPos + uRead, LastError());
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&] { return !full_blocks.empty(); });
+            auto block = full_blocks.front();
+            full_blocks.pop();
+            lock.unlock();
+
+            if (!block)
+                break;
+
+            status(block->pos);
+
+            if (block->bad_sector >= 0)
+                Message(msgStatus, "Read error at sector %lu: %s", uSrcOffset_ + block->pos + block->bad_sector, block->error.c_str());
 
-            // Clear the bad block, but include it in the read data
-            memset(mem + (uRead * sector_size), 0, sector_size);
-            ++uRead;
+            write_block(*block, IsZeroFilled(block->mem, block->sectors * sector_size));
+
+            lock.lock();
+            free_blocks.push(block);
+            cond.notify_all();
+        }
+    }
+    catch (...)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            abort = true;
+            cond.notify_all();
         }
 
-        // Forced byte-swapping?
-        if (opt.byteswap)
-            ByteSwap(mem, uRead * sector_size);
+        reader.join();
+        throw;
+    }
+
+    reader.join();
+    status(uSectors_, true);
+
+    return true;
+}
 
-        // Write to target disk
-        auto uWritten = Write(mem, uRead);
-        if (uWritten != uRead)
+
+// Progress map for resumable copies. It's saved as text lines holding the
+// start sector, sector count, and a status character:
+//  ? = not yet tried, + = copied, * = failed in a large block, - = bad sector
+// It starts with '=' lines identifying the source and target it belongs to.
+class COPY_MAP
+{
+public:
+    COPY_MAP(const std::string& path, int64_t sectors, const std::string& identity)
+        : m_path(path), m_identity(identity), m_sectors(sectors)
+    {
+        set(0, sectors, '?');
+    }
+
+    // Check an existing map belongs to this copy, returning false if there is none
+    bool check() const
+    {
+        std::ifstream file(m_path);
+        if (!file)
+            return false;
+
+        std::string identity, line;
+        while (std::getline(file, line))
         {
-            Message(msgStatus, "Write error at sector %lu: %s", uDstOffset_ + uPos + uWritten, LastError());
+            if (!line.empty() && line[0] == '=')
+                identity += line + '\n';
+        }
+
+        if (identity != m_identity)
+            throw util::exception(m_path, " is the copy map for a different source or target");
 
-            // Skip past the write error
-            ++uWritten;
+        return true;
+    }
+
+    bool load()
+    {
+        if (!check())
+            return false;
+
+        std::ifstream file(m_path);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#' || line[0] == '=')
+                continue;
+
+            std::istringstream ss(line);
+            int64_t start = 0, count = 0;
+            char status = 0;
+            if (!(ss >> start >> count >> status) || start < 0 || count <= 0 ||
+                start + count > m_sectors || !std::strchr("?+*-", status))
+                throw util::exception("invalid copy map entry '", line, "' in ", m_path);
+
+            set(start, count, status);
         }
 
-        // Advance by the amount written
-        uPos += uWritten;
+        return true;
+    }
+
+    void save() const
+    {
+        auto tmp_path = m_path + ".tmp";
+        std::ofstream file(tmp_path);
+        file << "# SAMdisk copy map: start count status\n" << m_identity;
+        for (auto& region : m_regions)
+            file << region.first << ' ' << (region.second.first - region.first) << ' ' << region.second.second << '\n';
+        file.close();
+
+        // Replace the old map in one step, so an interruption can't lose it
+        if (!file || std::rename(tmp_path.c_str(), m_path.c_str()) != 0)
+            throw util::exception("failed to write copy map ", m_path);
     }
 
+    void set(int64_t start, int64_t count, char status)
+    {
+        auto end = start + count;
+
+        // Trim or split any regions overlapping the new one
+        auto it = m_regions.upper_bound(start);
+        if (it != m_regions.begin())
+            --it;
+
+        while (it != m_regions.end() && it->first < end)
+        {
+            auto r_start = it->first, r_end = it->second.first;
+            auto r_status = it->second.second;
+            if (r_end <= start)
+            {
+                ++it;
+                continue;
+            }
+
+            it = m_regions.erase(it);
+            if (r_start < start)
+                m_regions[r_start] = { start, r_status };
+            if (r_end > end)
+                m_regions[end] = { r_end, r_status };
+        }
+
+        m_regions[start] = { end, status };
+
+        // Merge with neighbours of the same status
+        it = m_regions.find(start);
+        auto next = std::next(it);
+        if (next != m_regions.end() && next->second.second == status)
+        {
+            it->second.first = next->second.first;
+            m_regions.erase(next);
+        }
+        if (it != m_regions.begin())
+        {
+            auto prev = std::prev(it);
+            if (prev->second.first == start && prev->second.second == status)
+            {
+                prev->second.first = it->second.first;
+                m_regions.erase(it);
+            }
+        }
+    }
+
+    std::vector<std::pair<int64_t, int64_t>> ranges(char status) const
+    {
+        std::vector<std::pair<int64_t, int64_t>> ret;
+        for (auto& region : m_regions)
+        {
+            if (region.second.second == status)
+                ret.emplace_back(region.first, region.second.first - region.first);
+        }
+        return ret;
+    }
+
+    int64_t count(char status) const
+    {
+        int64_t total = 0;
+        for (auto& range : ranges(status))
+            total += range.second;
+        return total;
+    }
+
+private:
+    std::string m_path;
+    std::string m_identity;
+    int64_t m_sectors = 0;
+    std::map<int64_t, std::pair<int64_t, char>> m_regions{};   // start -> (end, status)
+};
+
+// Identity lines for a copy map, so it can't be resumed against other disks
+/*static*/ std::string HDD::CopyMapIdentity(const std::string& src_path, const HDD& src, const std::string& dst_path, const HDD& dst)
+{
+    auto identity = [](const char* role, const std::string& path, const HDD& hdd) {
+        return util::fmt("= %s %lld %d [%s] ", role, static_cast<long long>(hdd.total_sectors),
+            hdd.sector_size, hdd.strSerialNumber.c_str()) + path + '\n';
+    };
+
+    return identity("source", src_path, src) + identity("target", dst_path, dst);
+}
+
+// True if a copy map exists for the given copy, throwing if it belongs to a different one
+/*static*/ bool HDD::CheckCopyMap(const std::string& map_path, const std::string& identity)
+{
+    return COPY_MAP(map_path, 0, identity).check();
+}
+
+// Copy with a persistent progress map, so an interrupted copy of a failing
+// disk can be resumed. Large blocks are read first, failed blocks are then
+// bisected down to single sectors, and any bad sectors retried last.
+bool HDD::Rescue(HDD* phSrc_, int64_t uSectors_, const std::string& map_path, const std::string& map_identity)
+{
+    auto block_sectors = opt.blocksize > 0 ? std::max(1, opt.blocksize * 1024 / sector_size) : SECTOR_BLOCK;
+    MEMORY mem(block_sectors * sector_size);
+
+    COPY_MAP map(map_path, uSectors_, map_identity);
+    if (map.load())
+        Message(msgInfo, "resuming copy with %lld of %lld sectors remaining",
+            static_cast<long long>(uSectors_ - map.count('+')), static_cast<long long>(uSectors_));
+
+    auto last_save = std::chrono::steady_clock::now();
+    auto status = [&](const char* action) {
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_save >= PROGRESS_INTERVAL)
+        {
+            Message(msgStatus, "%s... %d%%", action, static_cast<int>(map.count('+') * 100 / uSectors_));
+            map.save();
+            last_save = now;
+        }
+    };
+
+    // Copy a range, returning the number of sectors read without error
+    auto copy_range = [&](int64_t start, int count) {
+        phSrc_->Seek(start);
+        auto uRead = phSrc_->Read(mem, count);
+
+        if (uRead > 0)
+        {
+            if (opt.byteswap)
+                ByteSwap(mem, uRead * sector_size);
+
+            Seek(start);
+            if (Write(mem, uRead) != uRead)
+                throw util::exception("write error at sector ", start, ": ", LastError());
+
+            map.set(start, uRead, '+');
+        }
+
+        return uRead;
+    };
+
+    // Pass 1: large blocks, skipping the remainder of any block that fails
+    for (auto& range : map.ranges('?'))
+    {
+        for (auto pos = range.first, end = range.first + range.second; pos < end; )
+        {
+            auto count = static_cast<int>(std::min<int64_t>(end - pos, block_sectors));
+            auto uRead = copy_range(pos, count);
+            if (uRead != count)
+                map.set(pos + uRead, count - uRead, '*');
+
+            pos += count;
+            status("Copying");
+        }
+    }
+
+    // Pass 2: bisect failed blocks to isolate the bad sectors
+    for (auto& range : map.ranges('*'))
+    {
+        // Adjacent failures may have merged, so start from block-sized pieces
+        std::vector<std::pair<int64_t, int64_t>> todo;
+        for (auto end = range.first + range.second; end > range.first; )
+        {
+            auto count = (end - range.first) % block_sectors;
+            if (!count) count = block_sectors;
+            todo.emplace_back(end - count, count);
+            end -= count;
+        }
+
+        while (!todo.empty())
+        {
+            auto start = todo.back().first, count = todo.back().second;
+            todo.pop_back();
+
+            auto uRead = copy_range(start, static_cast<int>(count));
+            if (uRead == count)
+                continue;
+
+            start += uRead;
+            count -= uRead;
+
+            if (count == 1)
+                map.set(start, 1, '-');
+            else
+            {
+                // Second half goes first, so we work forwards through the disk
+                todo.emplace_back(start + count / 2, count - count / 2);
+                todo.emplace_back(start, count / 2);
+            }
+
+            status("Isolating bad sectors");
+        }
+    }
+
+    // Pass 3: retry the individual bad sectors
+    for (auto retry = 0; retry < opt.retries && map.count('-'); ++retry)
+    {
+        for (auto& range : map.ranges('-'))
+        {
+            for (auto sector = range.first; sector < range.first + range.second; ++sector)
+            {
+                if (copy_range(sector, 1) == 1)
+                    Message(msgInfo, "recovered sector %lld on retry %d", static_cast<long long>(sector), retry + 1);
+
+                status("Retrying bad sectors");
+            }
+        }
+    }
+
+    // Clear anything still unreadable, so the target doesn't keep old data
+    memset(mem, 0, sector_size);
+    for (auto& range : map.ranges('-'))
+    {
+        for (auto sector = range.first; sector < range.first + range.second; ++sector)
+        {
+            Message(msgStatus, "Read error at sector %lld", static_cast<long long>(sector));
+            Seek(sector);
+            Write(mem, 1);
+        }
+    }
+
+    map.save();
+    Message(msgStatus, "Copying... 100%%");
+
+    if (auto bad = map.count('-'))
+        Message(msgWarning, "%lld unreadable sector%s, see %s", static_cast<long long>(bad), (bad == 1) ? "" : "s", map_path.c_str());
+
     return true;
 }
 
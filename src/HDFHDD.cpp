@@ -128,6 +128,12 @@ bool HDFHDD::Create(const std::string& path, uint64_t total_bytes_, const IDENTI
             write(h, sIdentify.byte, sIdentify.len) != static_cast<int>(sIdentify.len)))
         fRet = false;
 
+#if defined(HAVE_FTRUNCATE) && !defined(_WIN32)
+    // Extend to the full size without writing, leaving a sparse file that reads as zero
+    if (fRet && ftruncate(h, static_cast<off_t>(total_bytes + data_offset)) != 0)
+        fRet = false;
+#endif
+
     // If anything went wrong, delete the (possibly partial) file
     if (!fRet)
     {
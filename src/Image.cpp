@@ -6,6 +6,16 @@
 #include "types.h"
 #include "BlockDevice.h"
 
+#include <filesystem>
+
+#ifdef _WIN32
+#include <share.h>  // for _SH_DENYNO
+#endif
+
+namespace fs = std::filesystem;
+
+constexpr size_t OUTPUT_BUFFER_SIZE = 1024 * 1024;
+
 bool UnwrapSDF(std::shared_ptr<Disk>& src_disk, std::shared_ptr<Disk>& disk);
 
 bool ReadImage(const std::string& path, std::shared_ptr<Disk>& disk, bool normalise)
@@ -104,6 +114,133 @@ bool ReadImage(const std::string& path, std::shared_ptr<Disk>& disk, bool normal
 }
 
 
+// Read only what's needed for image details, falling back on a full read for
+// types without a header-only probe.
+bool ProbeImage(const std::string& path, std::shared_ptr<Disk>& disk)
+{
+    if (IsFile(path))
+    {
+        for (auto p = aProbeTypes; p->pszType; ++p)
+        {
+            if (p->pfnProbe(path, disk))
+                return true;
+        }
+    }
+
+    return ReadImage(path, disk);
+}
+
+
+// Move a completed file over the target, replacing any existing file
+static bool ReplaceFile(const std::string& from_path, const std::string& to_path)
+{
+#ifdef _WIN32
+    if (MoveFileEx(from_path.c_str(), to_path.c_str(), MOVEFILE_REPLACE_EXISTING))
+        return true;
+
+    errno = EACCES;
+    return false;
+#else
+    return std::rename(from_path.c_str(), to_path.c_str()) == 0;
+#endif
+}
+
+static Compress OutputCompression(const std::string& path)
+{
+    if (IsFileExt(path, "gz"))
+        return Compress::Gzip;
+    else if (IsFileExt(path, "xz"))
+        return Compress::Xz;
+    else if (IsFileExt(path, "zip"))
+        return Compress::Zip;
+
+    return Compress::None;
+}
+
+// Create a uniquely named file alongside the target, so concurrent writers
+// to the same target can't collide. It takes the mode of any existing target,
+// or the usual mode for a new file otherwise.
+static FILE* CreateTempFile(const std::string& target_path, std::string& temp_path)
+{
+#ifdef _WIN32
+    // _mktemp_s names can repeat between threads, so the open must be exclusive
+    for (auto i = 0; i < 26; ++i)
+    {
+        temp_path = target_path + ".XXXXXX";
+        if (_mktemp_s(&temp_path[0], temp_path.size() + 1) != 0)
+            return nullptr;
+
+        int fd = -1;
+        auto err = _sopen_s(&fd, temp_path.c_str(), _O_CREAT | _O_EXCL | _O_WRONLY | _O_BINARY,
+            _SH_DENYNO, _S_IREAD | _S_IWRITE);
+        if (err == EEXIST)
+            continue;
+        else if (err != 0)
+            return nullptr;
+
+        auto file = _fdopen(fd, "wb");
+        if (!file)
+        {
+            _close(fd);
+            std::remove(temp_path.c_str());
+        }
+
+        return file;
+    }
+
+    errno = EEXIST;
+    return nullptr;
+#else
+    temp_path = target_path + ".XXXXXX";
+
+    auto fd = mkstemp(&temp_path[0]);
+    if (fd == -1)
+        return nullptr;
+
+    struct stat st {};
+    if (stat(target_path.c_str(), &st) == 0)
+    {
+        // Ownership is kept where permitted, which needs privileges for other users
+        fchmod(fd, st.st_mode & 07777);
+        if (fchown(fd, st.st_uid, st.st_gid) != 0)
+            fchmod(fd, st.st_mode & 0777);
+    }
+    else
+    {
+        // mkstemp creates the file private, so use the mode fopen would give.
+        // The umask can only be read by changing it, so that's done just once.
+        static const auto mask = [] {
+            auto old_mask = umask(0);
+            umask(old_mask);
+            return old_mask;
+        }();
+        fchmod(fd, 0666 & ~mask);
+    }
+
+    auto file = fdopen(fd, "wb");
+    if (!file)
+    {
+        close(fd);
+        std::remove(temp_path.c_str());
+    }
+
+    return file;
+#endif
+}
+
+// Pack a completed image file into a compressed output file. The image is
+// read back in blocks as they're compressed, rather than all at once.
+static void WriteCompressed(FILE* file, FILE* out, Compress compress, const std::string& name, const std::string& path)
+{
+    if (fflush(file) != 0)
+        throw posix_error(errno, path.c_str());
+
+    CompressFile(file, out, compress, name);
+
+    if (ferror(out))
+        throw posix_error(errno, path.c_str());
+}
+
 bool WriteImage(const std::string& path, std::shared_ptr<Disk>& disk)
 {
     bool f = false;
@@ -126,11 +263,15 @@ bool WriteImage(const std::string& path, std::shared_ptr<Disk>& disk)
     {
         auto p = aImageTypes;
 
+        // Compressed output uses the type of the inner image, as in image.dsk.gz
+        auto compress = OutputCompression(path);
+        auto image_path = (compress == Compress::None) ? path : fs::path(path).replace_extension().string();
+
         // Find the type matching the output file extension
         for (; p->pszType; ++p)
         {
             // Matching extension with write
-            if (IsFileExt(path, p->pszType))
+            if (IsFileExt(image_path, p->pszType))
                 break;
         }
 
@@ -139,9 +280,48 @@ bool WriteImage(const std::string& path, std::shared_ptr<Disk>& disk)
         else if (!p->pfnWrite)
             throw util::exception(util::format(p->pszType, " is not supported for output"));
 
-        FILE* file = fopen(path.c_str(), "wb");
+        // Prepare all tracks in the writer's form in parallel, ahead of the serial write
+        disk->preencode(p->writeData);
+
+        // Write files via a temporary file that replaces the target when
+        // complete, so a failure leaves any original intact. Symbolic links
+        // are followed so they're kept. Files with other hard links, and
+        // other existing paths such as devices, are written in place.
+        std::error_code ec;
+        auto status = fs::status(path, ec);
+        auto replace = !fs::exists(status) ||
+            (fs::is_regular_file(status) && fs::hard_link_count(path, ec) <= 1);
+        auto target_path = fs::is_symlink(fs::symlink_status(path, ec)) ?
+            fs::canonical(path, ec).string() : path;
+        auto write_path = path;
+
+        FILE* out = nullptr;
+        if (replace)
+            out = CreateTempFile(target_path, write_path);
+        else
+            out = fopen(write_path.c_str(), "wb");
+
+        if (!out)
+            throw posix_error(errno, write_path.c_str());
+
+        // Remove incomplete output, but never an existing device
+        auto discard = [&]() {
+            if (replace || fs::is_regular_file(status))
+                std::remove(write_path.c_str());
+        };
+
+        // Compressed images are written to a temporary file to be packed
+        FILE* file = (compress == Compress::None) ? out : std::tmpfile();
         if (!file)
-            throw posix_error(errno, path.c_str());
+        {
+            auto error = errno;
+            fclose(out);
+            discard();
+            throw posix_error(error, write_path.c_str());
+        }
+
+        // Combine the many small writes from the image writers
+        setvbuf(file, nullptr, _IOFBF, OUTPUT_BUFFER_SIZE);
 
         try
         {
@@ -149,15 +329,38 @@ bool WriteImage(const std::string& path, std::shared_ptr<Disk>& disk)
             f = p->pfnWrite(file, disk);
             if (!f)
                 throw util::exception("output type is unsuitable for source content");
+
+            if (ferror(file))
+                throw posix_error(errno, write_path.c_str());
+
+            if (compress != Compress::None)
+            {
+                WriteCompressed(file, out, compress, fs::path(image_path).filename().string(), write_path);
+                fclose(file);
+            }
         }
         catch (...)
         {
-            fclose(file);
-            std::remove(path.c_str());
+            if (file != out)
+                fclose(file);
+            fclose(out);
+            discard();
             throw;
         }
 
-        fclose(file);
+        if (fclose(out) != 0)
+        {
+            auto error = errno;
+            discard();
+            throw posix_error(error, write_path.c_str());
+        }
+
+        if (replace && !ReplaceFile(write_path, target_path))
+        {
+            auto error = errno;
+            discard();
+            throw posix_error(error, target_path.c_str());
+        }
     }
 
     return true;
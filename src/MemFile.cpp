@@ -2,6 +2,7 @@
 
 #include "SAMdisk.h"
 #include "MemFile.h"
+#include "ThreadPool.h"
 
 #ifdef HAVE_ZLIB
 #include <zlib.h>
@@ -31,6 +32,316 @@ std::string to_string(const Compress& compression)
 }
 
 
+constexpr size_t COMPRESS_BLOCK_SIZE = 128 * 1024;
+
+static void WriteOutput(FILE* out, const void* pv, size_t len)
+{
+    if (len && fwrite(pv, 1, len, out) != len)
+        throw util::exception("write error, disk full?");
+}
+
+// Read the next block of input, or a short block at the end of it
+static Data ReadInput(FILE* in)
+{
+    Data block(COMPRESS_BLOCK_SIZE);
+    auto len = fread(block.data(), 1, block.size(), in);
+    if (ferror(in))
+        throw util::exception("read error packing image");
+
+    block.resize(len);
+    return block;
+}
+
+#ifdef HAVE_ZLIB
+// Raw deflate of a block. All but the last block end in a sync flush, so
+// independently compressed blocks join into a single stream.
+static Data DeflateBlock(const Data& data, bool last)
+{
+    z_stream stream{};
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        throw util::exception("deflate initialisation failed");
+
+    // Allow for the sync flush marker on top of the worst case size
+    Data out(deflateBound(&stream, static_cast<uLong>(data.size())) + 16);
+
+    stream.next_in = const_cast<Bytef*>(data.data());
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = out.data();
+    stream.avail_out = static_cast<uInt>(out.size());
+
+    auto zerr = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    out.resize(out.size() - stream.avail_out);
+    deflateEnd(&stream);
+
+    if (zerr != (last ? Z_STREAM_END : Z_OK) || stream.avail_in || !stream.avail_out)
+        throw util::exception("deflate compression failed (", zerr, ")");
+
+    return out;
+}
+
+struct DeflateResult
+{
+    uint32_t crc = 0;
+    uint64_t size = 0;
+    uint64_t packed_size = 0;
+};
+
+// Deflate the input as a stream of blocks, compressed in parallel with a
+// limited number in flight, and written to the output in order.
+static DeflateResult DeflateFile(FILE* in, FILE* out)
+{
+    DeflateResult result;
+    result.crc = static_cast<uint32_t>(crc32(0, nullptr, 0));
+
+    // A null buffer would reset the CRC, so skip empty blocks
+    auto add_input = [&](const Data& block) {
+        if (!block.empty())
+            result.crc = static_cast<uint32_t>(crc32(result.crc, block.data(), static_cast<uInt>(block.size())));
+        result.size += block.size();
+    };
+
+    // Read a block ahead, so we know which block is the last
+    auto next_block = [&](const Data& block) {
+        auto next = (block.size() == static_cast<int>(COMPRESS_BLOCK_SIZE)) ? ReadInput(in) : Data();
+        add_input(next);
+        return next;
+    };
+
+    auto write_block = [&](const Data& packed) {
+        WriteOutput(out, packed.data(), packed.size());
+        result.packed_size += packed.size();
+    };
+
+    rewind(in);
+    auto block = ReadInput(in);
+    add_input(block);
+
+    if (opt.mt != 0 && ThreadPool::get_thread_count() > 1)
+    {
+        ThreadPool pool;
+        std::deque<std::future<Data>> rets;
+
+        // Limit the blocks in flight, to bound memory use
+        auto max_pending = 2 * ThreadPool::get_thread_count();
+
+        for (auto last = false; !last; )
+        {
+            auto next = next_block(block);
+            last = next.empty();
+            rets.push_back(pool.enqueue(DeflateBlock, std::move(block), last));
+            block = std::move(next);
+
+            if (static_cast<int>(rets.size()) > max_pending)
+            {
+                write_block(rets.front().get());
+                rets.pop_front();
+            }
+        }
+
+        for (; !rets.empty(); rets.pop_front())
+            write_block(rets.front().get());
+    }
+    else
+    {
+        for (auto last = false; !last; )
+        {
+            auto next = next_block(block);
+            last = next.empty();
+            write_block(DeflateBlock(block, last));
+            block = std::move(next);
+        }
+    }
+
+    return result;
+}
+
+static void AppendLE(Data& data, uint32_t value, int bytes)
+{
+    for (auto i = 0; i < bytes; ++i)
+        data.push_back(static_cast<uint8_t>(value >> (i * 8)));
+}
+
+static void GzipFile(FILE* in, FILE* out, const std::string& filename)
+{
+    // Header with the original filename, then deflate data, CRC and size
+    static const uint8_t header[]{ 0x1f, 0x8b, Z_DEFLATED, 0x08, 0, 0, 0, 0, 2, 0xff };
+    Data gz(std::begin(header), std::end(header));
+    gz.insert(gz.end(), filename.begin(), filename.end());
+    gz.push_back(0);
+    WriteOutput(out, gz.data(), gz.size());
+
+    auto deflated = DeflateFile(in, out);
+
+    Data trailer;
+    AppendLE(trailer, deflated.crc, 4);
+    AppendLE(trailer, static_cast<uint32_t>(deflated.size), 4);
+    WriteOutput(out, trailer.data(), trailer.size());
+}
+
+static void ZipFile(FILE* in, FILE* out, const std::string& filename)
+{
+    // Timestamp in DOS format, as used by the archive entries
+    auto now = std::time(nullptr);
+    auto tm = *std::localtime(&now);
+    auto dos_time = static_cast<uint32_t>((tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2));
+    auto dos_date = static_cast<uint32_t>(((std::max(tm.tm_year, 80) - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+
+    // Fields shared by the local header and central directory entry. The
+    // sizes and CRC aren't known until the data is written, so the local
+    // header leaves them zero and they follow the data in a descriptor.
+    auto add_entry_fields = [&](Data& zip, const DeflateResult& deflated) {
+        AppendLE(zip, 20, 2);       // version needed to extract
+        AppendLE(zip, 0x0008, 2);   // flags: data descriptor
+        AppendLE(zip, Z_DEFLATED, 2);
+        AppendLE(zip, dos_time, 2);
+        AppendLE(zip, dos_date, 2);
+        AppendLE(zip, deflated.crc, 4);
+        AppendLE(zip, static_cast<uint32_t>(deflated.packed_size), 4);
+        AppendLE(zip, static_cast<uint32_t>(deflated.size), 4);
+        AppendLE(zip, static_cast<uint32_t>(filename.size()), 2);
+        AppendLE(zip, 0, 2);        // extra field length
+    };
+
+    Data zip;
+    AppendLE(zip, 0x04034b50, 4);
+    add_entry_fields(zip, DeflateResult());
+    zip.insert(zip.end(), filename.begin(), filename.end());
+    WriteOutput(out, zip.data(), zip.size());
+    auto header_size = zip.size();
+
+    auto deflated = DeflateFile(in, out);
+    if (deflated.size > std::numeric_limits<uint32_t>::max() ||
+        deflated.packed_size > std::numeric_limits<uint32_t>::max())
+        throw util::exception("image is too big for zip output");
+
+    zip.clear();
+    AppendLE(zip, 0x08074b50, 4);
+    AppendLE(zip, deflated.crc, 4);
+    AppendLE(zip, static_cast<uint32_t>(deflated.packed_size), 4);
+    AppendLE(zip, static_cast<uint32_t>(deflated.size), 4);
+
+    auto dir_offset = static_cast<uint32_t>(header_size + deflated.packed_size + zip.size());
+    AppendLE(zip, 0x02014b50, 4);
+    AppendLE(zip, 20, 2);           // version made by
+    add_entry_fields(zip, deflated);
+    AppendLE(zip, 0, 2);            // comment length
+    AppendLE(zip, 0, 2);            // disk number
+    AppendLE(zip, 0, 2);            // internal attributes
+    AppendLE(zip, 0, 4);            // external attributes
+    AppendLE(zip, 0, 4);            // local header offset
+    zip.insert(zip.end(), filename.begin(), filename.end());
+    auto dir_size = static_cast<uint32_t>(header_size + deflated.packed_size + zip.size()) - dir_offset;
+
+    AppendLE(zip, 0x06054b50, 4);
+    AppendLE(zip, 0, 2);            // this disk
+    AppendLE(zip, 0, 2);            // directory disk
+    AppendLE(zip, 1, 2);            // entries on this disk
+    AppendLE(zip, 1, 2);            // total entries
+    AppendLE(zip, dir_size, 4);
+    AppendLE(zip, dir_offset, 4);
+    AppendLE(zip, 0, 2);            // comment length
+    WriteOutput(out, zip.data(), zip.size());
+}
+#endif // HAVE_ZLIB
+
+#ifdef HAVE_LZMA
+// Multi-block xz, streamed through the encoder with the blocks compressed on
+// separate threads. liblzma limits the data it holds in flight.
+static void XzFile(FILE* in, FILE* out)
+{
+    if (fseek(in, 0, SEEK_END) != 0)
+        throw util::exception("seek error packing image");
+    auto size = static_cast<uint64_t>(ftell(in));
+    rewind(in);
+
+    lzma_mt mt{};
+    mt.threads = (opt.mt != 0) ? std::max(1u, static_cast<uint32_t>(ThreadPool::get_thread_count())) : 1;
+    mt.preset = LZMA_PRESET_DEFAULT;
+    mt.check = LZMA_CHECK_CRC64;
+
+    // Images are small compared to the default block size, so split them
+    // to give each thread a share.
+    mt.block_size = std::max<uint64_t>(1024 * 1024, (size + mt.threads - 1) / mt.threads);
+
+    lzma_stream strm = LZMA_STREAM_INIT;
+    auto ret = lzma_stream_encoder_mt(&strm, &mt);
+    if (ret != LZMA_OK)
+        throw util::exception("xz compression failed (", ret, ")");
+
+    Data input, output(COMPRESS_BLOCK_SIZE);
+    strm.next_out = output.data();
+    strm.avail_out = output.size();
+
+    auto action = LZMA_RUN;
+    try
+    {
+        for (;;)
+        {
+            if (!strm.avail_in && action == LZMA_RUN)
+            {
+                input = ReadInput(in);
+                strm.next_in = input.data();
+                strm.avail_in = input.size();
+                if (input.size() < static_cast<int>(COMPRESS_BLOCK_SIZE))
+                    action = LZMA_FINISH;
+            }
+
+            ret = lzma_code(&strm, action);
+
+            if (!strm.avail_out || ret == LZMA_STREAM_END)
+            {
+                WriteOutput(out, output.data(), output.size() - strm.avail_out);
+                strm.next_out = output.data();
+                strm.avail_out = output.size();
+            }
+
+            if (ret != LZMA_OK)
+                break;
+        }
+    }
+    catch (...)
+    {
+        lzma_end(&strm);
+        throw;
+    }
+
+    lzma_end(&strm);
+
+    if (ret != LZMA_STREAM_END)
+        throw util::exception("xz compression failed (", ret, ")");
+}
+#endif // HAVE_LZMA
+
+// Compress a complete uncompressed image file to the output file
+void CompressFile(FILE* in, FILE* out, Compress compress, const std::string& filename)
+{
+    switch (compress)
+    {
+    case Compress::Gzip:
+    case Compress::Zip:
+#ifndef HAVE_ZLIB
+        throw util::exception("zlib support is not available for ", to_string(compress), " output");
+#else
+        if (compress == Compress::Gzip)
+            GzipFile(in, out, filename);
+        else
+            ZipFile(in, out, filename);
+        break;
+#endif
+
+    case Compress::Xz:
+#ifndef HAVE_LZMA
+        throw util::exception("lzma support is not available");
+#else
+        XzFile(in, out);
+        break;
+#endif
+
+    default:
+        throw util::exception(to_string(compress), " output is not supported");
+    }
+}
+
 bool MemFile::open(const std::string& path_, bool uncompress)
 {
     std::string filename;
@@ -312,6 +623,15 @@ const Data& MemFile::data() const
     return m_data;
 }
 
+// Hand over the file data, leaving the file empty
+Data MemFile::release()
+{
+    Data data = std::move(m_data);
+    m_data.clear();
+    m_it = m_data.begin();
+    return data;
+}
+
 int MemFile::size() const
 {
     return static_cast<int>(m_data.size());
@@ -0,0 +1,129 @@
+// Regular-format disk, for raw sector images
+
+#include "SAMdisk.h"
+#include "RegularDisk.h"
+
+RegularDisk::RegularDisk(const Format& format, Data&& data, bool cyls_first)
+    : m_format(format), m_data(std::move(data)), m_cyls_first(cyls_first)
+{
+    // Extend the disk to the full format, ahead of building the tracks
+    m_format.range().each([&](const CylHead& cylhead) {
+        m_trackdata[cylhead].cylhead = cylhead;
+        });
+
+    fmt = m_format;
+}
+
+int RegularDisk::track_offset(const CylHead& cylhead) const
+{
+    auto index = m_cyls_first ?
+        (cylhead.head * m_format.cyls + cylhead.cyl) :
+        (cylhead.cyl * m_format.heads + cylhead.head);
+
+    return index * m_format.track_size();
+}
+
+Track RegularDisk::build_track(const CylHead& cylhead) const
+{
+    Track track;
+    track.format(cylhead, m_format);
+
+    auto offset = std::min(track_offset(cylhead), static_cast<int>(m_data.size()));
+    track.populate(m_data.begin() + offset, m_data.end());
+    return track;
+}
+
+bool RegularDisk::preencode(PreferredData data)
+{
+    // Sector writers copy pristine images straight from the image data
+    if (m_pristine && data == PreferredData::Track)
+        return false;
+
+    return Disk::preencode(data);
+}
+
+const TrackData& RegularDisk::read(const CylHead& cylhead, bool uncached)
+{
+    std::unique_lock<std::mutex> lock(m_trackdata_mutex);
+
+    // Build tracks still backed by the image data on first access
+    if (!m_loaded[cylhead] && m_trackdata.find(cylhead) != m_trackdata.end() &&
+        cylhead.cyl < m_format.cyls && cylhead.head < m_format.heads)
+    {
+        lock.unlock();
+        auto track = build_track(cylhead);
+        lock.lock();
+
+        if (!m_loaded[cylhead])
+        {
+            m_trackdata[cylhead] = TrackData(cylhead, std::move(track));
+            m_loaded[cylhead] = true;
+        }
+    }
+
+    lock.unlock();
+    return Disk::read(cylhead, uncached);
+}
+
+const TrackData& RegularDisk::write(TrackData&& trackdata)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_trackdata_mutex);
+        m_loaded[trackdata.cylhead] = true;
+        m_pristine = false;
+    }
+
+    return Disk::write(std::move(trackdata));
+}
+
+void RegularDisk::clear()
+{
+    Disk::clear();
+    m_loaded.reset();
+    m_pristine = false;
+}
+
+void RegularDisk::load_all()
+{
+    m_format.range().each([&](const CylHead& cylhead) {
+        read(cylhead);
+        });
+}
+
+void RegularDisk::flip_sides()
+{
+    // Track positions no longer match the image data, so build them all first
+    load_all();
+    m_pristine = false;
+    Disk::flip_sides();
+}
+
+void RegularDisk::resize(int cyls, int heads)
+{
+    load_all();
+    m_pristine = false;
+    Disk::resize(cyls, heads);
+}
+
+// True if the disk content still matches the image data
+bool RegularDisk::pristine() const
+{
+    return m_pristine;
+}
+
+// Image data for a sector on an untouched disk, or nullptr if not present.
+// Bytes may be less than the sector size if the image data is short.
+const uint8_t* RegularDisk::sector_data(const Header& header, int& bytes) const
+{
+    auto index = header.sector - m_format.base;
+
+    // Match Track::find, which ignores the head value in the header
+    if (!m_pristine || header.cyl >= m_format.cyls || header.head >= m_format.heads ||
+        header.size != m_format.size ||
+        index < 0 || index >= m_format.sectors)
+        return nullptr;
+
+    auto offset = track_offset(CylHead(header.cyl, header.head)) + index * m_format.sector_size();
+    bytes = std::max(0, std::min(m_format.sector_size(), static_cast<int>(m_data.size()) - offset));
+    return m_data.data() + std::min(offset, static_cast<int>(m_data.size()));
+}
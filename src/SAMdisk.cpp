@@ -6,10 +6,10 @@
 #include "BlockDevice.h"
 #include "FluxDecoder.h"
 
-enum { cmdCopy, cmdScan, cmdFormat, cmdList, cmdView, cmdInfo, cmdDir, cmdRpm, cmdVerify, cmdUnformat, cmdVersion, cmdCreate, cmdEnd };
+enum { cmdCopy, cmdScan, cmdFormat, cmdList, cmdView, cmdInfo, cmdDir, cmdRpm, cmdVerify, cmdUnformat, cmdVersion, cmdCreate, cmdIndex, cmdEnd };
 
 static const char* aszCommands[] =
-{ "copy",  "scan",  "format",  "list",  "view",  "info",  "dir",  "rpm",  "verify",  "unformat",  "version",  "create",  nullptr };
+{ "copy",  "scan",  "format",  "list",  "view",  "info",  "dir",  "rpm",  "verify",  "unformat",  "version",  "create",  "index",  nullptr };
 
 
 OPTIONS opt;
@@ -26,7 +26,7 @@ int Usage()
     Format fmtMGT = RegularFormat::MGT;
 
     util::cout << "\n"
-        << " SAMDISK [copy|scan|format|create|list|view|info|dir|rpm] <args>\n"
+        << " SAMDISK [copy|scan|verify|format|create|list|view|info|dir|rpm|index] <args>\n"
         << "\n"
         << "  -c, --cyls=N        cylinder count (N) or range (A-B)\n"
         << "  -h, --head=N        single head select (0 or 1)\n"
@@ -35,10 +35,11 @@ int Usage()
         << "  -R, --rescans=N     rescan count for full track reads (default=" << opt.rescans << ")\n"
         << "  -d, --double-step   step floppy head twice between tracks\n"
         << "  -f, --force         suppress confirmation prompts (careful!)\n"
+        << "      --batch=FILE    scan/info/dir/copy each image listed in FILE (- for stdin)\n"
         << "\n"
         << "The following apply to regular disk formats only:\n"
         << "  -n, --no-format     skip formatting stage when writing\n"
-        << "  -m, --minimal       read/write only used MGT tracks\n"
+        << "  -m, --minimal       read/write only used filesystem tracks\n"
         << "  -g, --gap3=N        override gap3 inter-sector spacing (default=0; auto)\n"
         << "  -i, --interleave=N  override sector interleave (default=" << fmtMGT.interleave << ")\n"
         << "  -k, --skew=N        override inter-track skew (default=" << fmtMGT.skew << ")\n"
@@ -139,7 +140,7 @@ enum {
     OPT_RPM = 256, OPT_LOG, OPT_VERSION, OPT_HEAD0, OPT_HEAD1, OPT_GAPMASK, OPT_MAXCOPIES,
     OPT_MAXSPLICE, OPT_CHECK8K, OPT_BYTES, OPT_HDF, OPT_ORDER, OPT_SCALE, OPT_PLLADJUST,
     OPT_PLLPHASE, OPT_ACE, OPT_MX, OPT_AGAT, OPT_NOFM, OPT_STEPRATE, OPT_PREFER, OPT_DEBUG,
-    OPT_BITSKIP
+    OPT_BITSKIP, OPT_BLOCKSIZE, OPT_MAP, OPT_BATCH
 };
 
 struct option long_options[] =
@@ -209,6 +210,7 @@ struct option long_options[] =
     { "no-ttb",           no_argument, &opt.nottb, 1},          // undocumented
     { "no-special",       no_argument, &opt.nospecial, 1 },     // undocumented
     { "byte-swap",        no_argument, &opt.byteswap, 1 },
+    { "discard",          no_argument, &opt.discard, 1 },
     { "atom",             no_argument, &opt.byteswap, 1 },
     { "lba",              no_argument, &opt.lba, 1 },
     { "trinity",          no_argument, &opt.lba, 1 },
@@ -247,6 +249,9 @@ struct option long_options[] =
     { "pll-adjust", required_argument, nullptr, OPT_PLLADJUST },
     { "pll-phase",  required_argument, nullptr, OPT_PLLPHASE },
     { "bit-skip",   required_argument, nullptr, OPT_BITSKIP },
+    { "block-size", required_argument, nullptr, OPT_BLOCKSIZE },
+    { "map",        required_argument, nullptr, OPT_MAP },
+    { "batch",      required_argument, nullptr, OPT_BATCH },
 
     { 0, 0, 0, 0 }
 };
@@ -430,6 +435,17 @@ bool ParseCommandLine(int argc_, char* argv_[])
             if (opt.bitskip < 0 || opt.bitskip > 31)
                 throw util::exception("invalid bit skip '", optarg, "', expected 0-31");
             break;
+        case OPT_BLOCKSIZE:
+            opt.blocksize = util::str_value<int>(optarg);
+            if (opt.blocksize <= 0 || opt.blocksize > 65536)
+                throw util::exception("invalid block size '", optarg, "', expected 1-65536 (KB)");
+            break;
+        case OPT_MAP:
+            opt.mapfile = optarg;
+            break;
+        case OPT_BATCH:
+            opt.batch = optarg;
+            break;
         case OPT_STEPRATE:
             opt.steprate = util::str_value<int>(optarg);
             if (opt.steprate > 15)
@@ -527,6 +543,81 @@ int GetArgType(const std::string& arg)
     return argDisk;
 }
 
+// Run a batch of images through scan, info, dir or copy
+static bool BatchCommand(int command, const std::vector<std::string>& args)
+{
+    std::vector<BatchJob> jobs;
+    std::string target_dir;
+
+    if (!opt.batch.empty())
+    {
+        jobs = ReadBatchList(opt.batch);
+
+        // An argument to a batch copy is the output directory
+        if (command == cmdCopy && args.size() == 1)
+            target_dir = args[0];
+        else if (!args.empty())
+            Usage();
+    }
+    else
+    {
+        // A multi-image copy writes to a directory named as the final argument
+        auto sources = args.size() - ((command == cmdCopy) ? 1 : 0);
+        for (size_t i = 0; i < sources; ++i)
+            jobs.push_back({ args[i], "" });
+
+        if (command == cmdCopy)
+            target_dir = args.back();
+    }
+
+    if (command == cmdCopy)
+    {
+        if (!target_dir.empty() && !IsDir(target_dir))
+            throw util::exception(target_dir, " is not a directory");
+
+        for (auto& job : jobs)
+        {
+            if (job.target.empty() && target_dir.empty())
+                throw util::exception("no target for ", job.source);
+            else if (job.target.empty())
+                job.target = target_dir + "/" + job.source.substr(job.source.find_last_of("/\\") + 1);
+        }
+    }
+
+    return RunBatch(jobs, [&](const BatchJob& job) {
+        auto nSource = GetArgType(job.source);
+
+        switch (command)
+        {
+        case cmdScan:
+            if (nSource == argBlock || nSource == argDisk)
+                return ScanImage(job.source, opt.range);
+            break;
+
+        case cmdInfo:
+            if (nSource == argHDD || nSource == argBlock)
+                return HddInfo(job.source, opt.verbose);
+            else if (nSource == argDisk)
+                return ImageInfo(job.source);
+            break;
+
+        case cmdDir:
+            if (nSource == argHDD)
+                return ListRecords(job.source);
+            else if (nSource == argDisk)
+                return DirImage(job.source);
+            break;
+
+        case cmdCopy:
+            if ((nSource == argBlock || nSource == argDisk) && GetArgType(job.target) == argDisk)
+                return ImageToImage(job.source, job.target);
+            break;
+        }
+
+        throw util::exception("unsupported source for batch mode");
+        });
+}
+
 int main(int argc_, char* argv_[])
 {
     auto start_time = std::chrono::system_clock::now();
@@ -569,6 +660,17 @@ int main(int argc_, char* argv_[])
         if (!ParseCommandLine(argc_, argv_))
             return 1;
 
+        // Multiple images, or a --batch list, are processed as a batch
+        std::vector<std::string> args(argv_ + optind, argv_ + argc_);
+        auto batch_cmd = opt.command == cmdScan || opt.command == cmdInfo ||
+            opt.command == cmdDir || opt.command == cmdCopy;
+        if (batch_cmd && (!opt.batch.empty() || args.size() > ((opt.command == cmdCopy) ? 2u : 1u)))
+        {
+            f = BatchCommand(opt.command, args);
+            opt.command = cmdEnd;
+            optind = argc_;
+        }
+
         // Read at most two non-option command-line arguments
         if (optind < argc_) strncpy(opt.szSource, argv_[optind++], arraysize(opt.szSource) - 1);
         if (optind < argc_) strncpy(opt.szTarget, argv_[optind++], arraysize(opt.szTarget) - 1);
@@ -586,6 +688,8 @@ int main(int argc_, char* argv_[])
 
             if (nSource == argDisk && IsTrinity(opt.szTarget))
                 f = Image2Trinity(opt.szSource, opt.szTarget);          // file/image -> Trinity
+            else if ((nSource == argHDD || nSource == argBlock) && IsDir(opt.szTarget))
+                f = ExportRecords(opt.szSource, opt.szTarget);          // hdd -> record images
             else if ((nSource == argBlock || nSource == argDisk) && (nTarget == argDisk || nTarget == argHDD /*for .raw*/))
                 f = ImageToImage(opt.szSource, opt.szTarget);           // image -> image
             else if ((nSource == argHDD || nSource == argBlock) && nTarget == argHDD)
@@ -689,7 +793,17 @@ int main(int argc_, char* argv_[])
         }
 
         case cmdVerify:
-            throw std::logic_error("verify command not yet implemented");
+        {
+            if (nSource == argNone || nTarget == argNone)
+                Usage();
+
+            if ((nSource == argBlock || nSource == argDisk) && nTarget == argDisk)
+                f = VerifyImage(opt.szSource, opt.szTarget, opt.range);
+            else
+                Usage();
+
+            break;
+        }
 
         case cmdCreate:
         {
@@ -751,6 +865,16 @@ int main(int argc_, char* argv_[])
             break;
         }
 
+        case cmdIndex:
+        {
+            // Directory and index file paths, or index file and image to look up
+            if (nSource == argNone || nTarget == argNone)
+                Usage();
+
+            f = IndexImages(opt.szSource, opt.szTarget);
+            break;
+        }
+
         case cmdVersion:
         {
             if (nSource != argNone || nTarget != argNone)
@@ -761,6 +885,9 @@ int main(int argc_, char* argv_[])
             break;
         }
 
+        case cmdEnd:    // batch already completed
+            break;
+
         default:
             Usage();
             break;
@@ -13,7 +13,7 @@ bool Sector::operator== (const Sector& sector) const
         return false;
 
     // If neither has data it's a match
-    if (sector.m_data.size() == 0 && m_data.size() == 0)
+    if (sector.copies() == 0 && copies() == 0)
         return true;
 
     // Both sectors must have some data
@@ -35,37 +35,46 @@ int Sector::size() const
 
 int Sector::data_size() const
 {
-    return copies() ? static_cast<int>(m_data[0].size()) : 0;
+    return copies() ? (*m_data)[0].size() : 0;
 }
 
-const DataList& Sector::datas() const
+// Writable access to the data copies, taking a private copy if they're shared
+DataList& Sector::writable_datas()
 {
-    return m_data;
+    if (!m_data)
+        m_data = std::make_shared<DataList>();
+    else if (m_data.use_count() > 1)
+        m_data = std::make_shared<DataList>(*m_data);
+
+    return *m_data;
 }
 
-DataList& Sector::datas()
+const DataList& Sector::datas() const
 {
-    return m_data;
+    static const DataList no_data;
+    return m_data ? *m_data : no_data;
 }
 
 const Data& Sector::data_copy(int copy/*=0*/) const
 {
-    copy = std::max(std::min(copy, static_cast<int>(m_data.size()) - 1), 0);
-    return m_data[copy];
+    copy = std::max(std::min(copy, copies() - 1), 0);
+    return datas()[copy];
 }
 
-Data& Sector::data_copy(int copy/*=0*/)
+Data& Sector::writable_data_copy(int copy/*=0*/)
 {
-    assert(m_data.size() != 0);
-    copy = std::max(std::min(copy, static_cast<int>(m_data.size()) - 1), 0);
-    return m_data[copy];
+    assert(copies() != 0);
+    copy = std::max(std::min(copy, copies() - 1), 0);
+    return writable_datas()[copy];
 }
 
 int Sector::copies() const
 {
-    return static_cast<int>(m_data.size());
+    return m_data ? static_cast<int>(m_data->size()) : 0;
 }
 
+// The data is only moved from if it's kept, so callers can reuse a buffer
+// that was ignored as a duplicate, without a new allocation.
 Sector::Merge Sector::add(Data&& new_data, bool bad_crc, uint8_t new_dam)
 {
     Merge ret = Merge::NewData;
@@ -112,7 +121,8 @@ Sector::Merge Sector::add(Data&& new_data, bool bad_crc, uint8_t new_dam)
         else if (copies() == 1)
         {
             // Can we identify the method used by the existing copy?
-            if (!ChecksumMethods(m_data[0].data(), m_data[0].size()).empty())
+            auto& data = (*m_data)[0];
+            if (!ChecksumMethods(data.data(), data.size()).empty())
             {
                 // Keep the existing, ignoring the new data
                 return Merge::Unchanged;
@@ -124,9 +134,10 @@ Sector::Merge Sector::add(Data&& new_data, bool bad_crc, uint8_t new_dam)
     auto complete_size = is_8k_sector() ? 0x1800 : new_data.size();
 
     // Compare existing data with the new data, to avoid storing redundant copies.
-    for (auto it = m_data.begin(); it != m_data.end(); )
+    // The copies are only written to if they change, so shared data stays shared.
+    for (auto i = 0; i < copies(); )
     {
-        auto& data = *it;
+        const auto& data = (*m_data)[i];
 
         if (data.size() >= complete_size && new_data.size() >= complete_size)
         {
@@ -146,7 +157,8 @@ Sector::Merge Sector::add(Data&& new_data, bool bad_crc, uint8_t new_dam)
                     return Merge::Unchanged;
 
                 // The new shorter copy replaces the existing data.
-                it = m_data.erase(it);
+                auto& datas = writable_datas();
+                datas.erase(datas.begin() + i);
                 ret = Merge::Improved;
                 continue;
             }
@@ -161,13 +173,14 @@ Sector::Merge Sector::add(Data&& new_data, bool bad_crc, uint8_t new_dam)
                     return Merge::Unchanged;
 
                 // The new longer copy replaces the existing data.
-                it = m_data.erase(it);
+                auto& datas = writable_datas();
+                datas.erase(datas.begin() + i);
                 ret = Merge::Improved;
                 continue;
             }
         }
 
-        ++it;
+        ++i;
     }
 
     // Will we now have multiple copies?
@@ -187,16 +200,16 @@ Sector::Merge Sector::add(Data&& new_data, bool bad_crc, uint8_t new_dam)
             return Merge::Unchanged;
 
         // Keep multiple copies the same size, whichever is shortest
-        auto new_size = std::min(new_data.size(), m_data[0].size());
+        auto new_size = std::min(new_data.size(), data_size());
         new_data.resize(new_size);
 
         // Resize any existing copies to match
-        for (auto& d : m_data)
+        for (auto& d : writable_datas())
             d.resize(new_size);
     }
 
     // Insert the new data copy.
-    m_data.emplace_back(std::move(new_data));
+    writable_datas().emplace_back(std::move(new_data));
     limit_copies(opt.maxcopies);
 
     // Update the data CRC state and DAM
@@ -232,14 +245,17 @@ Sector::Merge Sector::merge(Sector&& sector)
         return ret;
 
     // Add the new data snapshots
-    for (Data& data : sector.m_data)
+    if (sector.has_data())
     {
-        // Move the data into place, passing on the existing data CRC status and DAM
-        auto add_ret = add(std::move(data), sector.has_baddatacrc(), sector.dam);
-        if (add_ret == Merge::Improved || (ret == Merge::Unchanged))
-            ret = add_ret;
+        for (Data& data : sector.writable_datas())
+        {
+            // Move the data into place, passing on the existing data CRC status and DAM
+            auto add_ret = add(std::move(data), sector.has_baddatacrc(), sector.dam);
+            if (add_ret == Merge::Improved || (ret == Merge::Unchanged))
+                ret = add_ret;
+        }
     }
-    sector.m_data.clear();
+    sector.m_data.reset();
 
     return ret;
 }
@@ -314,15 +330,16 @@ void Sector::set_baddatacrc(bool bad)
         auto fill_byte = static_cast<uint8_t>((opt.fill >= 0) ? opt.fill : 0);
 
         if (!has_data())
-            m_data.push_back(Data(size(), fill_byte));
+            writable_datas().push_back(Data(size(), fill_byte));
         else if (copies() > 1)
         {
-            m_data.resize(1);
+            auto& datas = writable_datas();
+            datas.resize(1);
 
             if (data_size() < size())
             {
                 auto pad{ Data(size() - data_size(), fill_byte) };
-                m_data[0].insert(m_data[0].begin(), pad.begin(), pad.end());
+                datas[0].insert(datas[0].begin(), pad.begin(), pad.end());
             }
         }
     }
@@ -330,7 +347,7 @@ void Sector::set_baddatacrc(bool bad)
 
 void Sector::remove_data()
 {
-    m_data.clear();
+    m_data.reset();
     m_bad_data_crc = false;
     dam = 0xfb;
 }
@@ -338,7 +355,7 @@ void Sector::remove_data()
 void Sector::limit_copies(int max_copies)
 {
     if (copies() > max_copies)
-        m_data.resize(max_copies);
+        writable_datas().resize(max_copies);
 }
 
 void Sector::remove_gapdata(bool keep_crc/*=false*/)
@@ -346,7 +363,7 @@ void Sector::remove_gapdata(bool keep_crc/*=false*/)
     if (!has_gapdata())
         return;
 
-    for (auto& data : m_data)
+    for (auto& data : writable_datas())
     {
         // If requested, attempt to preserve CRC bytes on bad sectors.
         if (keep_crc && has_baddatacrc() && data.size() >= (size() + 2))
@@ -7,7 +7,6 @@
 #include "SAMdisk.h"
 #include "IBMPC.h"
 #include "BitstreamTrackBuilder.h"
-#include "FluxTrackBuilder.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -16,17 +15,47 @@ bool IsEmptyTrack(const Track& track)
     return track.size() == 0;
 }
 
+// Blank tracks are common, so the gap-filled bitstream for each datarate,
+// encoding and length is built once and copied for every track needing it.
+static std::mutex empty_track_mutex;
+static std::map<std::tuple<DataRate, Encoding, int>, BitBuffer> empty_track_cache;
+
+const BitBuffer& EmptyTrackBitstream(DataRate datarate, Encoding encoding, int track_bytes)
+{
+    std::lock_guard<std::mutex> lock(empty_track_mutex);
+    auto key = std::make_tuple(datarate, encoding, track_bytes);
+    auto it = empty_track_cache.find(key);
+    if (it == empty_track_cache.end())
+    {
+        BitstreamTrackBuilder bitbuf(datarate, encoding);
+        bitbuf.addBlock((encoding == Encoding::FM) ? 0xff : 0x4e, track_bytes);
+        it = empty_track_cache.emplace(key, std::move(bitbuf.buffer())).first;
+    }
+
+    return it->second;
+}
+
+// Check for an unmodified copy of an empty track bitstream we've generated
+bool IsEmptyTrackBitstream(const BitBuffer& bitbuf)
+{
+    // Each byte of gap filler is 16 bitcells in FM and MFM
+    std::lock_guard<std::mutex> lock(empty_track_mutex);
+    auto it = empty_track_cache.find(std::make_tuple(bitbuf.datarate, bitbuf.encoding, bitbuf.size() / 16));
+    if (it == empty_track_cache.end())
+        return false;
+
+    auto& empty = it->second;
+    return bitbuf.size() == empty.size() && bitbuf.indexes() == empty.indexes() && bitbuf.data() == empty.data();
+}
+
 TrackData GenerateEmptyTrack(const CylHead& cylhead, const Track& track)
 {
     assert(IsEmptyTrack(track));
     (void)track;
 
-    // Generate a DD track full of gap filler. It shouldn't really matter
+    // Use a DD track full of gap filler. It shouldn't really matter
     // which datarate and encoding as long as there are no sync marks.
-    BitstreamTrackBuilder bitbuf(DataRate::_250K, Encoding::MFM);
-    bitbuf.addBlock(0x4e, 6250);
-
-    return TrackData(cylhead, std::move(bitbuf.buffer()));
+    return TrackData(cylhead, BitBuffer(EmptyTrackBitstream(DataRate::_250K, Encoding::MFM, 6250)));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -208,9 +237,6 @@ TrackData GenerateSpectrumSpeedlockTrack(const CylHead& cylhead, const Track& tr
     assert(weak_offset == temp_offset && weak_size == temp_size);
 #endif
 
-    FluxTrackBuilder fluxbuf(cylhead, DataRate::_250K, Encoding::MFM);
-    fluxbuf.addTrackStart();
-
     BitstreamTrackBuilder bitbuf(DataRate::_250K, Encoding::MFM);
     bitbuf.addTrackStart();
 
@@ -219,18 +245,6 @@ TrackData GenerateSpectrumSpeedlockTrack(const CylHead& cylhead, const Track& tr
         auto& data_copy = sector.data_copy();
         auto is_weak{ &sector == &track[1] };
 
-        if (!is_weak)
-            fluxbuf.addSector(sector.header, data_copy, 0x54, sector.dam);
-        else
-        {
-            fluxbuf.addSectorUpToData(sector.header, sector.dam);
-            fluxbuf.addBlock(Data(data_copy.begin(), data_copy.begin() + weak_offset));
-            fluxbuf.addWeakBlock(weak_size);
-            fluxbuf.addBlock(Data(
-                data_copy.begin() + weak_offset + weak_size,
-                data_copy.begin() + sector.size()));
-        }
-
         bitbuf.addSector(sector.header, data_copy, 0x2e, sector.dam, is_weak);
 
         // Add duplicate weak sector half way around track.
@@ -245,7 +259,6 @@ TrackData GenerateSpectrumSpeedlockTrack(const CylHead& cylhead, const Track& tr
 
     TrackData trackdata(cylhead);
     trackdata.add(std::move(bitbuf.buffer()));
-    //trackdata.add(FluxData({ fluxbuf.buffer() }));
     return trackdata;
 }
 
@@ -312,9 +325,6 @@ TrackData GenerateCpcSpeedlockTrack(const CylHead& cylhead, const Track& track,
     assert(weak_offset == temp_offset && weak_size == temp_size);
 #endif
 
-    FluxTrackBuilder fluxbuf(cylhead, DataRate::_250K, Encoding::MFM);
-    fluxbuf.addTrackStart();
-
     BitstreamTrackBuilder bitbuf(DataRate::_250K, Encoding::MFM);
     bitbuf.addTrackStart();
 
@@ -323,18 +333,6 @@ TrackData GenerateCpcSpeedlockTrack(const CylHead& cylhead, const Track& track,
         auto& data_copy = sector.data_copy();
         auto is_weak{ &sector == &track[7] };
 
-        if (!is_weak)
-            fluxbuf.addSector(sector.header, data_copy, 0x54, sector.dam);
-        else
-        {
-            fluxbuf.addSectorUpToData(sector.header, sector.dam);
-            fluxbuf.addBlock(Data(data_copy.begin(), data_copy.begin() + weak_offset));
-            fluxbuf.addWeakBlock(weak_size);
-            fluxbuf.addBlock(Data(
-                data_copy.begin() + weak_offset + weak_size,
-                data_copy.begin() + sector.size()));
-        }
-
         bitbuf.addSector(sector.header, data_copy, 0x2e, sector.dam, is_weak);
 
         // Add duplicate weak sector half way around track.
@@ -349,7 +347,6 @@ TrackData GenerateCpcSpeedlockTrack(const CylHead& cylhead, const Track& track,
 
     TrackData trackdata(cylhead);
     trackdata.add(std::move(bitbuf.buffer()));
-    //trackdata.add(FluxData({ fluxbuf.buffer() }));
     return trackdata;
 }
 
@@ -393,9 +390,6 @@ TrackData GenerateRainbowArtsTrack(const CylHead& cylhead, const Track& track, i
     assert(weak_offset == temp_offset && weak_size == temp_size);
 #endif
 
-    FluxTrackBuilder fluxbuf(cylhead, DataRate::_250K, Encoding::MFM);
-    fluxbuf.addTrackStart();
-
     BitstreamTrackBuilder bitbuf(DataRate::_250K, Encoding::MFM);
     bitbuf.addTrackStart();
 
@@ -404,18 +398,6 @@ TrackData GenerateRainbowArtsTrack(const CylHead& cylhead, const Track& track, i
         auto& data_copy = sector.data_copy();
         auto is_weak{ &sector == &track[1] };
 
-        if (!is_weak)
-            fluxbuf.addSector(sector.header, data_copy, 0x54, sector.dam);
-        else
-        {
-            fluxbuf.addSectorUpToData(sector.header, sector.dam);
-            fluxbuf.addBlock(Data(data_copy.begin(), data_copy.begin() + weak_offset));
-            fluxbuf.addWeakBlock(weak_size);
-            fluxbuf.addBlock(Data(
-                data_copy.begin() + weak_offset + weak_size,
-                data_copy.begin() + sector.size()));
-        }
-
         bitbuf.addSector(sector.header, data_copy, 0x2e, sector.dam, is_weak);
 
         // Add duplicate weak sector half way around track.
@@ -431,7 +413,6 @@ TrackData GenerateRainbowArtsTrack(const CylHead& cylhead, const Track& track, i
 
     TrackData trackdata(cylhead);
     trackdata.add(std::move(bitbuf.buffer()));
-    //trackdata.add(FluxData({ fluxbuf.buffer() }));
     return trackdata;
 }
 
@@ -501,9 +482,6 @@ TrackData GenerateKBIWeakSectorTrack(const CylHead& cylhead, const Track& track,
     assert(weak_offset == temp_offset && weak_size == temp_size);
 #endif
 
-    FluxTrackBuilder fluxbuf(cylhead, DataRate::_250K, Encoding::MFM);
-    fluxbuf.addTrackStart();
-
     BitstreamTrackBuilder bitbuf(DataRate::_250K, Encoding::MFM);
     bitbuf.addTrackStart();
 
@@ -513,18 +491,6 @@ TrackData GenerateKBIWeakSectorTrack(const CylHead& cylhead, const Track& track,
         auto& data_copy = sector.data_copy();
         auto is_weak = sector.header.size == 1;
 
-        if (!is_weak)
-            fluxbuf.addSector(sector.header, data_copy, 0x54, sector.dam);
-        else
-        {
-            fluxbuf.addSectorUpToData(sector.header, sector.dam);
-            fluxbuf.addBlock(Data(data_copy.begin(), data_copy.begin() + weak_offset));
-            fluxbuf.addWeakBlock(weak_size);
-            fluxbuf.addBlock(Data(
-                data_copy.begin() + weak_offset + weak_size,
-                data_copy.begin() + sector.size()));
-        }
-
         bitbuf.addSector(sector.header, data_copy, 1, sector.dam, is_weak);
 
         // Insert the duplicate sector earlier on the track.
@@ -539,7 +505,6 @@ TrackData GenerateKBIWeakSectorTrack(const CylHead& cylhead, const Track& track,
 
     TrackData trackdata(cylhead);
     trackdata.add(std::move(bitbuf.buffer()));
-    //trackdata.add(FluxData({ fluxbuf.buffer() }));
     return trackdata;
 }
 
@@ -271,7 +271,7 @@ bool FixPlus3BootLoader(std::shared_ptr<Disk>& disk)
         // Replace the original sector with our modified version
         CylHead cylhead(0, 0);
         auto t = disk->read_track(cylhead);
-        t.find(sector->header)->datas().assign({ std::move(data) });
+        t.find(sector->header)->writable_datas().assign({ std::move(data) });
         disk->write(cylhead, std::move(t));
 
         return true;
@@ -293,7 +293,7 @@ bool FixPlus3BootLoader(std::shared_ptr<Disk>& disk)
 
         CylHead cylhead(1, 0);
         auto t = disk->read_track(cylhead);
-        t.find(sector->header)->datas().assign({ std::move(data) });
+        t.find(sector->header)->writable_datas().assign({ std::move(data) });
         disk->write(cylhead, std::move(t));
 
         Message(msgFix, "corrected motor issue in Shadow Warriors second-stage loader");
@@ -44,6 +44,8 @@ const std::vector<Sector>& Track::sectors() const
 
 std::vector<Sector>& Track::sectors()
 {
+    // Offsets may be changed through this, so stop relying on their order
+    m_offset_ordered = false;
     return m_sectors;
 }
 
@@ -61,10 +63,7 @@ Sector& Track::operator [] (int index)
 
 int Track::index_of(const Sector& sector) const
 {
-    auto it = std::find_if(begin(), end(), [&](const Sector& s) {
-        return &s == &sector;
-        });
-
+    auto it = find(sector);
     return (it == end()) ? -1 : static_cast<int>(std::distance(begin(), it));
 }
 
@@ -176,7 +175,7 @@ void Track::clear()
 void Track::add(Track&& track)
 {
     // Ignore if no sectors to add
-    if (!track.sectors().size())
+    if (track.empty())
         return;
 
     // Use longest track length and time
@@ -184,7 +183,7 @@ void Track::add(Track&& track)
     tracktime = std::max(tracktime, track.tracktime);
 
     // Merge supplied sectors into existing track
-    for (auto& s : track.sectors())
+    for (auto& s : track.m_sectors)
     {
         assert(s.offset != 0);
         add(std::move(s));
@@ -200,31 +199,59 @@ Track::AddResult Track::add(Sector&& sector)
     // If there's no positional information, simply append
     if (sector.offset == 0)
     {
+        if (!m_sectors.empty() && m_sectors.back().offset != 0)
+            m_offset_ordered = false;
+
         m_sectors.emplace_back(std::move(sector));
         return AddResult::Append;
     }
     else
     {
-        // Find a sector close enough to the new offset to be the same one
-        auto it = std::find_if(begin(), end(), [&](const Sector& s) {
+        auto same_sector = [&](const Sector& s) {
             auto offset_min = std::min(sector.offset, s.offset);
             auto offset_max = std::max(sector.offset, s.offset);
             auto distance = std::min(offset_max - offset_min, tracklen + offset_min - offset_max);
 
             // Sector must be close enough and have the same header
-            if (distance <= COMPARE_TOLERANCE_BITS && sector.header == s.header)
-                return true;
-
-            return false;
-            });
+            return distance <= COMPARE_TOLERANCE_BITS && sector.header == s.header;
+        };
+
+        // Sectors added with offsets are kept in offset order, but unpositioned
+        // sectors, insert(), and access through sectors() can all break that,
+        // which clears m_offset_ordered. In order, only the sectors within the
+        // tolerance either side of the new offset need checking, plus those
+        // near the opposite end of the track if it could wrap.
+        auto by_offset = [](const Sector& s, int offset) { return s.offset < offset; };
+        auto lower = [&](int offset) { return std::lower_bound(begin(), end(), offset, by_offset); };
+
+        // Find the first (track order) sector close enough to be the same one
+        auto it = end();
+        auto search = [&](std::vector<Sector>::iterator first, std::vector<Sector>::iterator last) {
+            last = std::min(last, it);
+            auto match = std::find_if(first, std::max(first, last), same_sector);
+            if (match != std::max(first, last))
+                it = match;
+        };
+
+        if (m_offset_ordered)
+        {
+            auto wrap_bits = tracklen - COMPARE_TOLERANCE_BITS;
+            search(begin(), lower(sector.offset - wrap_bits + 1));
+            search(lower(sector.offset - COMPARE_TOLERANCE_BITS), lower(sector.offset + COMPARE_TOLERANCE_BITS + 1));
+            search(lower(sector.offset + wrap_bits), end());
+        }
+        else
+            search(begin(), end());
 
         // If that failed, we have a new sector with an offset
         if (it == end())
         {
-            // Find the insertion point to keep the sectors in order
-            it = std::find_if(begin(), end(), [&](const Sector& s) {
-                return sector.offset < s.offset;
-                });
+            // Insert before the first sector with a later offset, which is
+            // after any sectors at the same offset if the track is in order
+            auto later = [&](const Sector& s) { return sector.offset < s.offset; };
+            it = m_offset_ordered ?
+                std::upper_bound(begin(), end(), sector.offset, [](int offset, const Sector& s) { return offset < s.offset; }) :
+                std::find_if(begin(), end(), later);
             m_sectors.emplace(it, std::move(sector));
             return AddResult::Insert;
         }
@@ -277,7 +304,7 @@ Data::const_iterator Track::populate(Data::const_iterator it, Data::const_iterat
     {
         assert(sector->copies() == 1);
         auto bytes = std::min(sector->size(), static_cast<int>(std::distance(it, itEnd)));
-        std::copy_n(it, bytes, sector->data_copy(0).begin());
+        std::copy_n(it, bytes, sector->writable_data_copy(0).begin());
         it += bytes;
     }
 
@@ -293,6 +320,7 @@ void Track::insert(int index, Sector&& sector)
 
     auto it = m_sectors.begin() + index;
     m_sectors.insert(it, std::move(sector));
+    m_offset_ordered = false;
 }
 
 Sector Track::remove(int index)
@@ -307,9 +335,13 @@ Sector Track::remove(int index)
 
 std::vector<Sector>::iterator Track::find(const Sector& sector)
 {
-    return std::find_if(begin(), end(), [&](const Sector& s) {
-        return &s == &sector;
-        });
+    // Sectors are stored contiguously, so the position follows from the address
+    auto data = m_sectors.data();
+    std::less<const Sector*> before;
+    if (before(&sector, data) || !before(&sector, data + m_sectors.size()))
+        return end();
+
+    return begin() + (&sector - data);
 }
 
 std::vector<Sector>::iterator Track::find(const Header& header)
@@ -328,9 +360,12 @@ std::vector<Sector>::iterator Track::find(const Header& header, const DataRate d
 
 std::vector<Sector>::const_iterator Track::find(const Sector& sector) const
 {
-    return std::find_if(begin(), end(), [&](const Sector& s) {
-        return &s == &sector;
-        });
+    auto data = m_sectors.data();
+    std::less<const Sector*> before;
+    if (before(&sector, data) || !before(&sector, data + m_sectors.size()))
+        return end();
+
+    return begin() + (&sector - data);
 }
 
 std::vector<Sector>::const_iterator Track::find(const Header& header) const
@@ -355,3 +390,49 @@ const Sector& Track::get_sector(const Header& header) const
 
     return *it;
 }
+
+
+Track::HeaderIndex::HeaderIndex(const Track& track)
+    : m_track(track)
+{
+    for (auto i = 0; i < track.size(); ++i)
+        m_indices[key(track[i].header)].push_back(i);
+}
+
+// Key on the fields compared by Header::operator==, which ignores the head
+uint64_t Track::HeaderIndex::key(const Header& header)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(header.cyl)) << 32) ^
+        (static_cast<uint64_t>(static_cast<uint16_t>(header.sector)) << 16) ^
+        static_cast<uint16_t>(header.size);
+}
+
+int Track::HeaderIndex::find(const Header& header, DataRate datarate, Encoding encoding) const
+{
+    auto it = m_indices.find(key(header));
+    if (it != m_indices.end())
+    {
+        for (auto index : it->second)
+        {
+            auto& s = m_track.get()[index];
+            if (header == s.header && datarate == s.datarate && encoding == s.encoding)
+                return index;
+        }
+    }
+
+    return -1;
+}
+
+bool Track::HeaderIndex::is_repeated(const Sector& sector) const
+{
+    auto it = m_indices.find(key(sector.header));
+    if (it == m_indices.end())
+        return false;
+
+    auto count = std::count_if(it->second.begin(), it->second.end(), [&](int index) {
+        auto& s = m_track.get()[index];
+        return s.datarate == sector.datarate && s.encoding == sector.encoding && s.header == sector.header;
+        });
+
+    return count > 1;
+}
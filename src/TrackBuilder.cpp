@@ -4,6 +4,42 @@
 #include "TrackBuilder.h"
 #include "IBMPC.h"
 
+// Spread the 8 bits of a byte across alternate bits of a 16-bit value,
+// leaving room for the MFM clock bit ahead of each data bit.
+static constexpr std::array<uint16_t, 256> MakeMfmSpread()
+{
+    std::array<uint16_t, 256> table{};
+    for (auto i = 0; i < 256; ++i)
+    {
+        for (auto bit = 0; bit < 8; ++bit)
+        {
+            if (i & (1 << bit))
+                table[i] |= 1 << (bit * 2);
+        }
+    }
+    return table;
+}
+
+// Spread the 8 bits of a byte to every 4th bit of a 32-bit value, as the
+// data bits of FM bit cells (clock, 0, data, 0).
+static constexpr std::array<uint32_t, 256> MakeFmSpread()
+{
+    std::array<uint32_t, 256> table{};
+    for (auto i = 0; i < 256; ++i)
+    {
+        for (auto bit = 0; bit < 8; ++bit)
+        {
+            if (i & (1 << bit))
+                table[i] |= 2u << (bit * 4);
+        }
+    }
+    return table;
+}
+
+static constexpr auto mfm_spread = MakeMfmSpread();
+static constexpr auto fm_spread = MakeFmSpread();
+
+
 TrackBuilder::TrackBuilder(DataRate datarate, Encoding encoding)
     : m_datarate(datarate)
 {
@@ -51,13 +87,29 @@ void TrackBuilder::addDataBit(bool bit)
     m_lastbit = bit;
 }
 
+void TrackBuilder::addEncodedByte(uint8_t /*byte*/, uint32_t bits, int count)
+{
+    while (count-- > 0)
+        addRawBit(((bits >> count) & 1) != 0);
+}
+
 void TrackBuilder::addByte(int byte)
 {
-    for (auto i = 0; i < 8; ++i)
+    byte &= 0xff;
+
+    if (m_encoding == Encoding::FM)
+    {
+        // FM has a reversal before every data bit
+        addEncodedByte(static_cast<uint8_t>(byte), (fm_spread[0xff] << 2) | fm_spread[byte], 32);
+    }
+    else
     {
-        addDataBit((byte & 0x80) != 0);
-        byte <<= 1;
+        // MFM has a reversal between consecutive zeros (clock or data)
+        auto clock = ~(byte | (byte >> 1) | (m_lastbit ? 0x80 : 0)) & 0xff;
+        addEncodedByte(static_cast<uint8_t>(byte), (mfm_spread[clock] << 1) | mfm_spread[byte], 16);
     }
+
+    m_lastbit = (byte & 1) != 0;
 }
 
 void TrackBuilder::addByteUpdateCrc(int byte)
@@ -68,15 +120,15 @@ void TrackBuilder::addByteUpdateCrc(int byte)
 
 void TrackBuilder::addByteWithClock(int data, int clock)
 {
-    for (auto i = 0; i < 8; ++i)
-    {
-        addBit((clock & 0x80) != 0);
-        addBit((data & 0x80) != 0);
-        clock <<= 1;
-        data <<= 1;
-    }
+    data &= 0xff;
+    clock &= 0xff;
+
+    if (m_encoding == Encoding::FM)
+        addEncodedByte(static_cast<uint8_t>(data), (fm_spread[clock] << 2) | fm_spread[data], 32);
+    else
+        addEncodedByte(static_cast<uint8_t>(data), (mfm_spread[clock] << 1) | mfm_spread[data], 16);
 
-    m_lastbit = (data & 0x100) != 0;
+    m_lastbit = (data & 1) != 0;
 }
 
 void TrackBuilder::addBlock(int byte, int count)
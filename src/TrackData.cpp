@@ -133,13 +133,13 @@ TrackData TrackData::preferred()
 void TrackData::add(TrackData&& trackdata)
 {
     if (trackdata.has_flux())
-        add(FluxData(trackdata.flux()), trackdata.has_normalised_flux());
+        add(std::move(trackdata.m_flux), trackdata.has_normalised_flux());
 
     if (trackdata.has_bitstream())
-        add(BitBuffer(trackdata.bitstream()));
+        add(std::move(trackdata.m_bitstream));
 
     if (trackdata.has_track())
-        add(Track(trackdata.track()));
+        add(std::move(trackdata.m_track));
 }
 
 void TrackData::add(Track&& track)
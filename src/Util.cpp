@@ -3,13 +3,13 @@
 #include "SAMdisk.h"
 
 std::set<std::string> seen_messages;
-
-static uint32_t adwUsed[2][3];
+std::mutex message_mutex;
+thread_local std::set<std::string> captured_messages;
 
 const char* ValStr(int val, const char* pcszDec_, const char* pcszHex_, bool fForceDecimal_)
 {
-    static char strs[8][32];
-    static int idx;
+    static thread_local char strs[8][32];
+    static thread_local int idx;
 
     // Next slot
     idx = (idx + 1) % arraysize(strs);
@@ -33,28 +33,28 @@ const char* SizeStr(int size) { return ValStr(size, "%d", "%" HEXCASE); }
 
 const char* CH(int cyl, int head)
 {
-    static char sz[64];
+    static thread_local char sz[64];
     snprintf(sz, sizeof(sz), "cyl %s head %s", CylStr(cyl), HeadStr(head));
     return sz;
 }
 
 const char* CHS(int cyl, int head, int sector)
 {
-    static char sz[64];
+    static thread_local char sz[64];
     snprintf(sz, sizeof(sz), "cyl %s head %s sector %d", CylStr(cyl), HeadStr(head), sector);
     return sz;
 }
 
 const char* CHR(int cyl, int head, int record)
 {
-    static char sz[64];
+    static thread_local char sz[64];
     snprintf(sz, sizeof(sz), "cyl %s head %s sector %s", CylStr(cyl), HeadStr(head), RecordStr(record));
     return sz;
 }
 
 const char* CHSR(int cyl, int head, int sector, int record)
 {
-    static char sz[128];
+    static thread_local char sz[128];
     snprintf(sz, sizeof(sz), "cyl %s head %s sector %d (id=%s)", CylStr(cyl), HeadStr(head), sector, RecordStr(record));
     return sz;
 }
@@ -409,78 +409,35 @@ void ByteSwap(void* pv, size_t len)
         std::swap(pb[i], pb[i + 1]);
 }
 
-
-void TrackUsedInit(Disk& disk)
+bool IsZeroFilled(const void* pv, size_t len)
 {
-    bool fDone = false;
-    uint8_t abBAM[195] = {};
-
-    // Tracks 0 and 4 cover the (empty) directory start and boot sector, and are always used
-    memset(&adwUsed, 0, sizeof(adwUsed));
-    adwUsed[0][0] |= 0x00000011;
+    auto pb = reinterpret_cast<const uint8_t*>(pv);
 
-    const Sector* sector = nullptr;
-    if (!disk.find(Header(0, 0, 1, 2), sector) || sector->data_size() < SECTOR_SIZE)
-        throw util::exception("disk is not MGT format");
-
-    MGT_DISK_INFO di;
-    const Data& data1 = sector->data_copy();
-    GetDiskInfo(data1.data(), di);
-
-    for (uint8_t cyl = 0; !fDone && cyl < di.dir_tracks; ++cyl)
+    // OR together 64-byte chunks, which compilers vectorise well,
+    // stopping at the first chunk containing a non-zero byte.
+    for (; len >= 64; pb += 64, len -= 64)
     {
-        for (uint8_t sec = 1; !fDone && sec <= MGT_SECTORS; ++sec)
-        {
-            // Skip the boot sector on MasterDOS extended directories
-            if (cyl == 4 && sec == 1)
-                continue;
-
-            CylHead cylhead(cyl, 0);
-            if (!disk.find(Header(cyl, 0, sec, 2), sector) || sector->data_size() < SECTOR_SIZE)
-                throw util::exception("cyl ", cyl, " head 0 sector ", sec, " not found");
-
-            for (int entry = 0; !fDone && entry < 2; ++entry)
-            {
-                const Data& data = sector->data_copy();
-                const MGT_DIR* pdi = reinterpret_cast<const MGT_DIR*>(data.data() + ((SECTOR_SIZE / 2) * entry));
-
-                if (pdi->bType & 0x3f)
-                {
-                    // Mark the current track as used
-                    adwUsed[0][cyl >> 5] |= (1 << (cyl & 0x1f));
-
-                    // If the final entry of the non-final track is in use, ensure the next track is considered used
-                    if (entry == 1 && sec == (MGT_SECTORS - 1) && cyl != (di.dir_tracks - 1))
-                        adwUsed[0][(cyl + 1) >> 5] |= (1 << ((cyl + 1) & 0x1f));
-
-                    // Merge the sector address map into the overall disk BAM
-                    for (size_t i = 0; i < sizeof(abBAM); ++i)
-                        abBAM[i] |= pdi->abSectorMap[i];
-                }
-                else
-                    fDone = !pdi->abName[0];
-            }
-        }
-    }
+        uint64_t words[8];
+        std::memcpy(words, pb, sizeof(words));
 
-    // Convert the BAM used sectors to our used tracks
-    for (size_t i = 0; i < (sizeof(abBAM) << 3); ++i)
-    {
-        // Sector in use?
-        if (abBAM[i >> 3] & (1 << (i & 7)))
-        {
-            uint8_t cyl = static_cast<uint8_t>((i / MGT_SECTORS) + MGT_DIR_TRACKS);
-            uint8_t head = cyl / NORMAL_TRACKS;
+        uint64_t bits = 0;
+        for (auto word : words)
+            bits |= word;
 
-            cyl %= NORMAL_TRACKS;
-            adwUsed[head][cyl >> 5] |= (1 << (cyl & 0x1f));
-        }
+        if (bits)
+            return false;
     }
+
+    return std::all_of(pb, pb + len, [](uint8_t b) { return b == 0; });
 }
 
-bool IsTrackUsed(int cyl_, int head_)
+// 64-bit FNV-1a hash, which can be continued by passing the previous hash
+uint64_t Fnv1a(const void* pv, size_t len, uint64_t hash/*=0xcbf29ce484222325ULL*/)
 {
-    return (adwUsed[head_ & 1][cyl_ >> 5] & (1 << (cyl_ & 0x1f))) != 0;
+    auto pb = reinterpret_cast<const uint8_t*>(pv);
+    for (size_t i = 0; i < len; ++i)
+        hash = (hash ^ pb[i]) * 0x100000001b3ULL;
+    return hash;
 }
 
 
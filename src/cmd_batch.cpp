@@ -0,0 +1,136 @@
+// Batch processing of multiple images in a single run
+
+#include "SAMdisk.h"
+#include "ThreadPool.h"
+
+struct BatchResult
+{
+    bool ok = false;
+    std::string output{};
+};
+
+// Read a list of jobs, one per line, with an optional tab-separated target.
+// Blank lines and lines starting with # are ignored.
+std::vector<BatchJob> ReadBatchList(const std::string& path)
+{
+    std::ifstream file;
+    if (path != "-")
+    {
+        file.open(path);
+        if (!file)
+            throw util::exception("failed to open batch list ", path);
+    }
+
+    auto& is = (path == "-") ? std::cin : static_cast<std::istream&>(file);
+
+    std::vector<BatchJob> jobs;
+    std::string line;
+    while (std::getline(is, line))
+    {
+        line = util::trim(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        BatchJob job;
+        auto tab = line.find('\t');
+        job.source = util::trim(line.substr(0, tab));
+        if (tab != line.npos)
+            job.target = util::trim(line.substr(tab + 1));
+
+        jobs.push_back(std::move(job));
+    }
+
+    return jobs;
+}
+
+static BatchResult RunJob(const BatchJob& job, const std::function<bool(const BatchJob&)>& run_job)
+{
+    BatchResult result;
+    std::ostringstream ss;
+
+    // Buffer everything the job writes, so parallel jobs don't interleave
+    util::LogHelper::capture = &ss;
+    captured_messages.clear();
+
+    try
+    {
+        result.ok = run_job(job);
+    }
+    catch (std::exception & e)
+    {
+        util::cout << "Error: " << e.what() << '\n';
+    }
+    catch (std::string & e)
+    {
+        util::cout << "Error: " << e << '\n';
+    }
+
+    util::LogHelper::capture = nullptr;
+    result.output = ss.str();
+    return result;
+}
+
+bool RunBatch(const std::vector<BatchJob>& jobs, const std::function<bool(const BatchJob&)>& run_job)
+{
+    if (jobs.empty())
+        throw util::exception("no images to process");
+
+    auto total = static_cast<int>(jobs.size());
+    auto done = 0, failed = 0;
+
+    // Progress is only shown on a terminal, to keep redirected output clean
+    auto tty = util::is_stdout_a_tty();
+
+    auto report = [&](const BatchJob& job, const BatchResult& result) {
+        util::cout << colour::CYAN << "==> " << job.source;
+        if (!job.target.empty())
+            util::cout << " -> " << job.target;
+        util::cout << " <==" << colour::none << "\n" << result.output;
+
+        if (!result.ok)
+        {
+            util::cout << colour::RED << "Failed: " << job.source << colour::none << "\n";
+            ++failed;
+        }
+
+        util::cout << "\n";
+        ++done;
+
+        if (tty)
+            Message(msgStatus, "Processed %d of %d images", done, total);
+    };
+
+    if (opt.mt != 0 && ThreadPool::get_thread_count() > 1 && total > 1)
+    {
+        // Parallelism comes from running whole images side by side, so keep
+        // each job single-threaded to avoid oversubscribing the cores.
+        auto saved_mt = opt.mt;
+        opt.mt = 0;
+
+        ThreadPool pool;
+        std::vector<std::future<BatchResult>> rets;
+        for (auto& job : jobs)
+            rets.push_back(pool.enqueue(RunJob, std::cref(job), std::cref(run_job)));
+
+        // Report in list order, as each result becomes available
+        for (size_t i = 0; i < rets.size(); ++i)
+            report(jobs[i], rets[i].get());
+
+        opt.mt = saved_mt;
+    }
+    else
+    {
+        for (auto& job : jobs)
+            report(job, RunJob(job, run_job));
+    }
+
+    if (tty)
+        Message(msgStatus, "");
+
+    if (failed)
+        util::cout << colour::RED << failed << " of " << total << " images failed" << colour::none << "\n";
+    else
+        util::cout << total << " images processed\n";
+
+    return !failed;
+}
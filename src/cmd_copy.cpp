@@ -1,22 +1,40 @@
 // Copy command
 
 #include "SAMdisk.h"
+#include "RegularDisk.h"
+#include "BitstreamDecoder.h"
 #include "Trinity.h"
 #include "SpectrumPlus3.h"
 
+// Untouched regular images copied whole, without options that change the
+// track content, can be written directly from the source image data.
+static bool IsDirectCopy(Disk& src_disk, const Range& range)
+{
+    auto regular_disk = dynamic_cast<RegularDisk*>(&src_disk);
+    if (!regular_disk || !regular_disk->pristine())
+        return false;
+
+    if (opt.merge || opt.repair || opt.minimal || opt.verbose || opt.step != 1 || opt.nodata ||
+        opt.fix == 1 || opt.gap3 != -1 || opt.datarate != DataRate::Unknown || opt.encoding != Encoding::Unknown ||
+        ScanEncodingHint::get() != Encoding::Unknown)
+        return false;
+
+    return range.cyl_begin == 0 && range.cyl_end == src_disk.cyls() &&
+        range.head_begin == 0 && range.head_end == src_disk.heads();
+}
+
 bool ImageToImage(const std::string& src_path, const std::string& dst_path)
 {
     auto src_disk = std::make_shared<Disk>();
     auto dst_disk = std::make_shared<Disk>();
     ScanContext context;
 
-    // Force Jupiter Ace reading mode if the output file extension is .dti
-    // ToDo: add mechanism for target to hint how source should be read?
-    if (opt.encoding != Encoding::Ace && IsFileExt(dst_path, "dti"))
-    {
-        opt.encoding = Encoding::Ace;
+    // Read as Jupiter Ace if the output file extension is .dti. This is a hint
+    // for this copy only, as batch copies run side by side and share opt.
+    auto ace_hint = opt.encoding == Encoding::Unknown && IsFileExt(dst_path, "dti");
+    ScanEncodingHint hint(ace_hint ? Encoding::Ace : ScanEncodingHint::get());
+    if (ace_hint)
         Message(msgInfo, "assuming --encoding=Ace due to .dti output image");
-    }
 
     // Read the source image
     if (!ReadImage(src_path, src_disk))
@@ -31,15 +49,18 @@ bool ImageToImage(const std::string& src_path, const std::string& dst_path)
     }
 
     // Limit to our maximum geometry, and default to copy everything present in the source
-    ValidateRange(opt.range, MAX_TRACKS, MAX_SIDES, opt.step, src_disk->cyls(), src_disk->heads());
+    auto range = opt.range;
+    ValidateRange(range, MAX_TRACKS, MAX_SIDES, opt.step, src_disk->cyls(), src_disk->heads());
+
+    if (IsDirectCopy(*src_disk, range))
+        return WriteImage(dst_path, src_disk);
 
-    if (opt.minimal)
-        TrackUsedInit(*src_disk);
+    auto used = opt.minimal ? GetUsedTracks(*src_disk) : UsedTracks().set();
 
     // Copy the range of tracks to the target image
-    opt.range.each([&](const CylHead& cylhead) {
+    range.each([&](const CylHead& cylhead) {
         // In minimal reading mode, skip unused tracks
-        if (opt.minimal && !IsTrackUsed(cylhead.cyl, cylhead.head))
+        if (!used[cylhead])
             return;
 
         Message(msgStatus, "Reading %s", CH(cylhead.cyl, cylhead.head));
@@ -200,16 +221,36 @@ bool Hdd2Hdd(const std::string& src_path, const std::string& dst_path)
     }
 
     if (!dst_hdd)
+    {
         Error("create");
-    else if (src_hdd->total_sectors != dst_hdd->total_sectors && !opt.resize)
+        return false;
+    }
+
+    // Resuming a mapped copy of the same disks doesn't need confirmation to overwrite the target
+    auto map_identity = HDD::CopyMapIdentity(src_path, *src_hdd, dst_path, *dst_hdd);
+    auto resuming = !fCreated && !opt.mapfile.empty() && HDD::CheckCopyMap(opt.mapfile, map_identity);
+
+    // A newly created target can't hold anything an existing map says was copied
+    if (fCreated && !opt.mapfile.empty() && IsFile(opt.mapfile))
+        throw util::exception(opt.mapfile, " is the copy map for a previous target");
+
+    if (src_hdd->total_sectors != dst_hdd->total_sectors && !opt.resize)
         throw util::exception("Source size (", src_hdd->total_sectors, " sectors) does not match target (", dst_hdd->total_sectors, " sectors)");
     else if (src_hdd->sector_size != dst_hdd->sector_size)
         throw util::exception("Source sector size (", src_hdd->sector_size, " bytes) does not match target (", dst_hdd->sector_size, " bytes)");
-    else if ((fCreated || dst_hdd->SafetyCheck()) && dst_hdd->Lock())
+    else if ((fCreated || resuming || dst_hdd->SafetyCheck()) && dst_hdd->Lock())
     {
         BDOS_CAPS bdcSrc, bdcDst;
 
-        if (opt.resize && IsBDOSDisk(*src_hdd, bdcSrc))
+        if (!opt.mapfile.empty())
+        {
+            if (opt.resize)
+                throw util::exception("--map can't be combined with --resize");
+
+            auto uCopy = std::min(src_hdd->total_sectors, dst_hdd->total_sectors);
+            f = dst_hdd->Rescue(src_hdd.get(), uCopy, opt.mapfile, map_identity);
+        }
+        else if (opt.resize && IsBDOSDisk(*src_hdd, bdcSrc))
         {
             GetBDOSCaps(dst_hdd->total_sectors, bdcDst);
 
@@ -681,20 +681,23 @@ static const CPM_DPB asDPB[] =
 };
 
 
-bool DirCpm(Disk& disk, const Sector& s)
+static const CPM_DPB* GetCpmDpb(Disk& disk, const Sector& s)
 {
-    const CPM_DPB* pdpb = nullptr;
-
     if (disk.cyls() >= NORMAL_TRACKS && disk.heads() == NORMAL_SIDES)   // PCW and Pro-Dos
-        pdpb = &asDPB[3];
+        return &asDPB[3];
     else if ((s.header.sector & 0xc0) == 0x40)  // CPC System
-        pdpb = &asDPB[1];
+        return &asDPB[1];
     else if ((s.header.sector & 0xc0) == 0xc0)  // CPC Data
-        pdpb = &asDPB[2];
+        return &asDPB[2];
     else if ((s.data_copy()[0] & 0x3f) < arraysize(asDPB))  // On-disk DPB?
-        pdpb = reinterpret_cast<const CPM_DPB*>(s.data_copy().data());
-    else
-        pdpb = &asDPB[0];   // +3
+        return reinterpret_cast<const CPM_DPB*>(s.data_copy().data());
+
+    return &asDPB[0];   // +3
+}
+
+bool DirCpm(Disk& disk, const Sector& s)
+{
+    auto pdpb = GetCpmDpb(disk, s);
 
     int nSectorsPerBlock = 1 << (pdpb->bBlockShift - pdpb->bSize);
     int nDirSectors = static_cast<uint8_t>(pdpb->bDirBlocks * nSectorsPerBlock);
@@ -1014,6 +1017,305 @@ bool Dir(Disk& disk)
     throw util::exception("unrecognised directory format");
 }
 
+static void MarkUsed(UsedTracks& used, int cyl, int head)
+{
+    if (cyl >= 0 && cyl < MAX_DISK_CYLS && head >= 0 && head < MAX_DISK_HEADS)
+        used[CylHead(cyl, head)] = true;
+}
+
+static void UsedTracksMgt(Disk& disk, UsedTracks& used)
+{
+    uint8_t abBAM[sizeof(MGT_DIR().abSectorMap)] = {};
+    bool fDone = false;
+
+    // Tracks 0 and 4 cover the (empty) directory start and boot sector, and are always used
+    MarkUsed(used, 0, 0);
+    MarkUsed(used, 4, 0);
+
+    MGT_DISK_INFO di;
+    GetDiskInfo(disk.get_sector(Header(0, 0, 1, 2)).data_copy().data(), di);
+
+    for (auto cyl = 0; !fDone && cyl < di.dir_tracks; ++cyl)
+    {
+        for (auto sec = 1; !fDone && sec <= MGT_SECTORS; ++sec)
+        {
+            // Skip the boot sector on MasterDOS extended directories
+            if (cyl == 4 && sec == 1)
+                continue;
+
+            auto& data = disk.get_sector(Header(cyl, 0, sec, 2)).data_copy();
+            if (data.size() < SECTOR_SIZE)
+                throw util::exception(CHR(cyl, 0, sec), " is too short");
+
+            for (int entry = 0; !fDone && entry < 2; ++entry)
+            {
+                auto pdi = reinterpret_cast<const MGT_DIR*>(data.data()) + entry;
+
+                if (pdi->bType & 0x3f)
+                {
+                    MarkUsed(used, cyl, 0);
+
+                    // If the final entry of the non-final track is in use, ensure the next track is considered used
+                    if (entry == 1 && sec == (MGT_SECTORS - 1) && cyl != (di.dir_tracks - 1))
+                        MarkUsed(used, cyl + 1, 0);
+
+                    // Merge the sector address map into the overall disk BAM
+                    for (size_t i = 0; i < sizeof(abBAM); ++i)
+                        abBAM[i] |= pdi->abSectorMap[i];
+                }
+                else
+                    fDone = !pdi->abName[0];
+            }
+        }
+    }
+
+    // Convert the BAM used sectors to our used tracks
+    for (size_t i = 0; i < (sizeof(abBAM) << 3); ++i)
+    {
+        if (abBAM[i >> 3] & (1 << (i & 7)))
+        {
+            auto cyl = static_cast<int>(i / MGT_SECTORS) + MGT_DIR_TRACKS;
+            MarkUsed(used, cyl % NORMAL_TRACKS, cyl / NORMAL_TRACKS);
+        }
+    }
+}
+
+static void UsedTracksTrDos(Disk& disk, UsedTracks& used)
+{
+    auto& data9 = disk.get_sector(Header(0, 0, 9, 1)).data_copy();
+    if (data9.size() < 256)
+        throw util::exception(CHR(0, 0, 9), " is too short");
+
+    auto heads = (data9[227] & 0x08) ? 1 : 2;
+
+    // TR-DOS allocates files sequentially, and only reclaims deleted space
+    // when the disk is compacted, so everything up to the end of the last
+    // file is in use. The first track holds the directory.
+    auto end_block = TRD_SECTORS;
+
+    for (uint8_t i = 1; i <= 8; ++i)
+    {
+        auto& sector = disk.get_sector(Header(0, 0, i, 1));
+        auto& data = sector.data_copy();
+
+        auto dir_entries = std::min(sector.size(), data.size()) / static_cast<int>(sizeof(TRDOS_DIR));
+        auto pd = reinterpret_cast<const TRDOS_DIR*>(data.data());
+
+        for (auto entry = 0; entry < dir_entries; ++entry, ++pd)
+        {
+            if (pd->abName[0])
+                end_block = std::max(end_block, pd->bStartTrack * TRD_SECTORS + pd->bStartSector + pd->bSectors);
+        }
+    }
+
+    // Logical tracks alternate between the heads on double-sided disks
+    for (auto track = 0; track * TRD_SECTORS < end_block; ++track)
+        MarkUsed(used, track / heads, track % heads);
+}
+
+static void UsedTracksOpus(Disk& disk, UsedTracks& used)
+{
+    auto& boot_data = disk.get_sector(Header(0, 0, 0, 1)).data_copy();
+    auto& ob = *reinterpret_cast<const OPD_BOOT*>(boot_data.data());
+    int cyls = ob.cyls, sectors = ob.sectors;
+    Format::Validate(cyls, (ob.flags & 0x10) ? 2 : 1, sectors);
+
+    // Block numbers are relative to the boot sector, which is always used
+    auto mark_blocks = [&](int first_block, int last_block) {
+        for (auto block = first_block; block <= last_block; ++block)
+            MarkUsed(used, (block / sectors) % cyls, (block / sectors) / cyls);
+    };
+    mark_blocks(0, 0);
+
+    Format fmt{ RegularFormat::OPD };
+    auto dir_entries = fmt.sector_size() / static_cast<int>(sizeof(OPUS_DIR));
+    auto cat_blocks = 1;
+
+    for (auto i = 1; i <= cat_blocks; ++i)
+    {
+        auto& data = disk.get_sector(Header(0, 0, i, 1)).data_copy();
+        auto pd = reinterpret_cast<const OPUS_DIR*>(data.data());
+
+        for (auto j = 0; j < dir_entries; ++j, ++pd)
+        {
+            auto first_block = ((pd->first_block[1] & 0x0f) << 8) | pd->first_block[0];
+            auto last_block = (pd->last_block[1] << 8) | pd->last_block[0];
+
+            // Directory terminator?
+            if (last_block == 0xffff)
+                return;
+
+            // The first entry covers the catalogue itself
+            if (i == 1 && !j)
+                cat_blocks = last_block - first_block + 1 - 1;
+
+            mark_blocks(first_block + 1, last_block + 1);
+        }
+    }
+}
+
+static void UsedTracksCpm(Disk& disk, const Sector& s, UsedTracks& used)
+{
+    auto pdpb = GetCpmDpb(disk, s);
+
+    int sectors_per_block = 1 << (pdpb->bBlockShift - pdpb->bSize);
+    int dir_sectors = pdpb->bDirBlocks * sectors_per_block;
+    uint8_t sector_base = (s.header.sector & 0xc0) + 1;
+    auto sidedness = pdpb->bSidedness & 3;
+    auto total_tracks = pdpb->bTracks * (sidedness ? 2 : 1);
+    auto total_blocks = (total_tracks - pdpb->bResTracks) * pdpb->bSectors / sectors_per_block;
+
+    auto mark_track = [&](int track) {
+        if (sidedness == 1)
+            MarkUsed(used, track >> 1, track & 1);
+        else if (track < pdpb->bTracks)
+            MarkUsed(used, track, 0);
+        else
+        {
+            // Up-and-over layouts may run the second side in either direction
+            MarkUsed(used, track - pdpb->bTracks, 1);
+            MarkUsed(used, total_tracks - 1 - track, 1);
+        }
+    };
+
+    auto mark_block = [&](int block) {
+        auto first_sector = block * sectors_per_block;
+        auto last_sector = first_sector + sectors_per_block - 1;
+        for (auto track = first_sector / pdpb->bSectors; track <= last_sector / pdpb->bSectors; ++track)
+            mark_track(pdpb->bResTracks + track);
+    };
+
+    for (auto track = 0; track < pdpb->bResTracks; ++track)
+        mark_track(track);
+
+    for (auto block = 0; block < pdpb->bDirBlocks; ++block)
+        mark_block(block);
+
+    for (auto i = 0; i < dir_sectors; ++i)
+    {
+        const Sector* sector = nullptr;
+        auto track = pdpb->bResTracks + (i / pdpb->bSectors);
+        auto cyl = (sidedness == 1) ? (track >> 1) : track;
+        auto head = (sidedness == 1) ? (track & 1) : 0;
+        auto sec = sector_base + (i % pdpb->bSectors);
+
+        if (!disk.find(Header(cyl, head, sec, pdpb->bSize), sector) || sector->has_shortdata())
+            throw util::exception(CHR(cyl, head, sec), " not found");
+
+        auto& data = sector->data_copy();
+        for (auto j = 0; j < sector->size() / static_cast<int>(sizeof(CPM_DIR)); ++j)
+        {
+            auto p = &reinterpret_cast<const CPM_DIR*>(data.data())[j];
+
+            // Only file entries own blocks
+            if (p->user > 0x0f)
+                continue;
+
+            // Disks with more than 256 blocks use 16-bit block numbers
+            for (auto k = 0; k < static_cast<int>(sizeof(p->blocks)); ++k)
+            {
+                int block = p->blocks[k];
+                if (total_blocks > 256)
+                    block |= p->blocks[++k] << 8;
+
+                if (block && block < total_blocks)
+                    mark_block(block);
+            }
+        }
+    }
+}
+
+static bool UsedTracksAce(Disk& disk, UsedTracks& used)
+{
+    const Sector* ps = nullptr;
+    auto data_offset = 0;
+    if (!IsDeepThoughtDisk(disk, ps) || !IsDeepThoughtSector(*ps, data_offset))
+        return false;
+
+    const Data& data = ps->data_copy();
+    const uint8_t* pb = data.data() + data_offset;
+    int tracks = pb[0];
+    pb += 3;
+
+    // The first two tracks hold the catalogue and its backup, followed by a
+    // file number (or zero if unused) for each remaining track.
+    for (auto track = 0; track < tracks; ++track)
+    {
+        if (track < 2 || pb[track - 2])
+        {
+            MarkUsed(used, track, 0);
+            MarkUsed(used, track, 1);
+        }
+    }
+
+    return true;
+}
+
+// Determine the tracks used by a recognised filesystem, with the same
+// detection as Dir(). Only the directory and allocation sectors are read.
+static bool FindUsedTracks(Disk& disk, UsedTracks& used)
+{
+    const Sector* sector = nullptr;
+
+    if (disk.find(Header(0, 0, 0, 5), sector))
+    {
+        if (IsDeepThoughtDisk(disk, sector))
+            return UsedTracksAce(disk, used);
+    }
+
+    if (disk.find(Header(0, 0, 1, 2), sector))
+    {
+        // MDOS allocation isn't decoded, so Didaktik disks use all tracks
+        if (IsDidaktikDirSector(*sector))
+            return false;
+        else if (IsCpmDirSector(*sector))
+            UsedTracksCpm(disk, *sector, used);
+        else if (IsMgtDirSector(*sector))
+            UsedTracksMgt(disk, used);
+        else
+            return false;
+    }
+    else if (disk.find(Header(0, 0, 1, 1), sector))
+    {
+        if (IsOpusDirSector(*sector))
+            UsedTracksOpus(disk, used);
+        else if (IsTrDosDirSector(*sector))
+            UsedTracksTrDos(disk, used);
+        else
+            return false;
+    }
+    else if (disk.find(Header(0, 0, 0x41, 2), sector) ||
+        disk.find(Header(0, 0, 0xc1, 2), sector))
+    {
+        if (IsCpmDirSector(*sector))
+            UsedTracksCpm(disk, *sector, used);
+        else
+            return false;
+    }
+    else
+        return false;
+
+    return true;
+}
+
+UsedTracks GetUsedTracks(Disk& disk)
+{
+    UsedTracks used;
+
+    try
+    {
+        if (FindUsedTracks(disk, used))
+            return used;
+    }
+    catch (util::exception & e)
+    {
+        Message(msgWarning, "%s", e.what());
+    }
+
+    Message(msgWarning, "no used track information for --minimal, so using all tracks");
+    return used.set();
+}
+
 bool DirImage(const std::string& path)
 {
     auto disk = std::make_shared<Disk>();
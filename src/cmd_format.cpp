@@ -137,6 +137,10 @@ bool FormatHdd(const std::string& path)
         // A quick format stops after the MGT boot sector in record 1
         int64_t total_sectors = opt.quick ? bdc.base_sectors + (MGT_DIR_TRACKS * MGT_SECTORS) + 1 : hdd_sectors;
 
+        // Optionally discard the old contents first, before we write over it
+        if (opt.discard && !hdd->Discard(0, total_sectors))
+            Message(msgWarning, "discard is not supported by this device");
+
         // Format the boot sector and record list
         f = hdd->Copy(nullptr, bdc.base_sectors, 0, 0, total_sectors, "Formatting");
 
@@ -0,0 +1,349 @@
+// Index command
+
+#include "SAMdisk.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+constexpr char INDEX_SIGNATURE[] = "SDIX";
+constexpr uint32_t INDEX_VERSION = 1;
+
+// Track hashes shared by more images than this are too common (blank or
+// filler tracks) to suggest a near-duplicate.
+constexpr int COMMON_TRACK_LIMIT = 64;
+constexpr int NEAR_MATCH_PERCENT = 90;
+
+struct IndexEntry
+{
+    std::string path{};
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint64_t disk_hash = 0;
+    std::vector<uint64_t> track_hashes{};   // non-blank tracks, in disk order
+};
+
+// Content hash of a track, independent of sector order, positions, gaps and
+// the container format. Only sector IDs and the natural data are included.
+static uint64_t TrackHash(const Track& track)
+{
+    std::vector<uint64_t> sector_hashes;
+    sector_hashes.reserve(track.size());
+
+    for (auto& sector : track)
+    {
+        uint8_t id[] = {
+            static_cast<uint8_t>(sector.header.cyl), static_cast<uint8_t>(sector.header.head),
+            static_cast<uint8_t>(sector.header.sector), static_cast<uint8_t>(sector.header.size) };
+
+        auto hash = Fnv1a(id, sizeof(id));
+        if (sector.has_data())
+        {
+            auto& data = sector.data_copy();
+            hash = Fnv1a(data.data(), std::min(data.size(), sector.size()), hash);
+        }
+        sector_hashes.push_back(hash);
+    }
+
+    std::sort(sector_hashes.begin(), sector_hashes.end());
+    return Fnv1a(sector_hashes.data(), sector_hashes.size() * sizeof(sector_hashes[0]));
+}
+
+static bool HashImage(IndexEntry& entry)
+{
+    auto disk = std::make_shared<Disk>();
+    if (!ReadImage(entry.path, disk))
+        return false;
+
+    entry.track_hashes.clear();
+    entry.disk_hash = Fnv1a(nullptr, 0);
+
+    disk->range().each([&](const CylHead& cylhead) {
+        auto& track = disk->read_track(cylhead);
+        if (track.empty())
+            return;
+
+        auto hash = TrackHash(track);
+        entry.track_hashes.push_back(hash);
+        entry.disk_hash = Fnv1a(&hash, sizeof(hash), entry.disk_hash);
+        });
+
+    return !entry.track_hashes.empty();
+}
+
+
+static std::map<std::string, IndexEntry> LoadIndex(const std::string& path)
+{
+    std::map<std::string, IndexEntry> entries;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return entries;
+
+    char sig[4]{};
+    file.read(sig, sizeof(sig));
+    if (std::memcmp(sig, INDEX_SIGNATURE, sizeof(sig)) || ReadValue<uint32_t>(file) != INDEX_VERSION)
+        throw util::exception(path, " is not a SAMdisk index");
+
+    auto count = ReadValue<uint32_t>(file);
+    for (uint32_t i = 0; i < count && file; ++i)
+    {
+        IndexEntry entry;
+        entry.path.resize(ReadValue<uint16_t>(file));
+        file.read(&entry.path[0], entry.path.size());
+        entry.size = ReadValue<uint64_t>(file);
+        entry.mtime = ReadValue<int64_t>(file);
+        entry.disk_hash = ReadValue<uint64_t>(file);
+        entry.track_hashes.resize(ReadValue<uint16_t>(file));
+        for (auto& hash : entry.track_hashes)
+            hash = ReadValue<uint64_t>(file);
+
+        entries[entry.path] = std::move(entry);
+    }
+
+    if (!file)
+        throw util::exception("short file reading ", path);
+
+    return entries;
+}
+
+static void SaveIndex(const std::string& path, const std::map<std::string, IndexEntry>& entries)
+{
+    auto tmp_path = path + ".tmp";
+    std::ofstream file(tmp_path, std::ios::binary);
+
+    file.write(INDEX_SIGNATURE, 4);
+    WriteValue<uint32_t>(file, INDEX_VERSION);
+    WriteValue<uint32_t>(file, static_cast<uint32_t>(entries.size()));
+
+    for (auto& p : entries)
+    {
+        auto& entry = p.second;
+        WriteValue<uint16_t>(file, static_cast<uint16_t>(entry.path.size()));
+        file.write(entry.path.data(), entry.path.size());
+        WriteValue<uint64_t>(file, entry.size);
+        WriteValue<int64_t>(file, entry.mtime);
+        WriteValue<uint64_t>(file, entry.disk_hash);
+        WriteValue<uint16_t>(file, static_cast<uint16_t>(entry.track_hashes.size()));
+        for (auto hash : entry.track_hashes)
+            WriteValue<uint64_t>(file, hash);
+    }
+
+    file.close();
+    if (!file || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+        throw util::exception("failed to write index ", path);
+}
+
+
+// Percentage of tracks two images have in common, relative to the larger
+static int SharedPercent(const IndexEntry& a, const IndexEntry& b)
+{
+    std::multiset<uint64_t> a_hashes(a.track_hashes.begin(), a.track_hashes.end());
+
+    auto shared = 0;
+    for (auto hash : b.track_hashes)
+    {
+        auto it = a_hashes.find(hash);
+        if (it != a_hashes.end())
+        {
+            a_hashes.erase(it);
+            ++shared;
+        }
+    }
+
+    auto tracks = std::max(a.track_hashes.size(), b.track_hashes.size());
+    return tracks ? static_cast<int>(shared * 100 / tracks) : 0;
+}
+
+// Report images matching the supplied one, or all matching pairs if null
+static void ReportMatches(const std::map<std::string, IndexEntry>& entries, const IndexEntry* target)
+{
+    // Map each disk and track hash to the images using it, for fast look-up
+    std::map<uint64_t, std::vector<const IndexEntry*>> by_disk, by_track;
+    for (auto& p : entries)
+    {
+        // Skip files kept only to avoid probing them again
+        if (p.second.track_hashes.empty())
+            continue;
+
+        by_disk[p.second.disk_hash].push_back(&p.second);
+        for (auto hash : std::set<uint64_t>(p.second.track_hashes.begin(), p.second.track_hashes.end()))
+            by_track[hash].push_back(&p.second);
+    }
+
+    auto report = [&](const IndexEntry& entry) {
+        // Only report each pair once when listing everything
+        auto wanted = [&](const IndexEntry* other) {
+            return other != &entry && (target || entry.path < other->path);
+        };
+
+        for (auto other : by_disk[entry.disk_hash])
+        {
+            if (wanted(other))
+                util::cout << "  identical: " << entry.path << " = " << other->path << "\n";
+        }
+
+        std::set<const IndexEntry*> candidates;
+        for (auto hash : std::set<uint64_t>(entry.track_hashes.begin(), entry.track_hashes.end()))
+        {
+            auto& users = by_track[hash];
+            if (static_cast<int>(users.size()) > COMMON_TRACK_LIMIT)
+                continue;
+
+            for (auto other : users)
+            {
+                if (wanted(other) && other->disk_hash != entry.disk_hash)
+                    candidates.insert(other);
+            }
+        }
+
+        for (auto other : candidates)
+        {
+            auto percent = SharedPercent(entry, *other);
+            if (percent >= NEAR_MATCH_PERCENT)
+                util::cout << util::fmt("  %3d%% same: ", percent) << entry.path << " ~ " << other->path << "\n";
+        }
+    };
+
+    if (target)
+        report(*target);
+    else
+    {
+        for (auto& p : entries)
+        {
+            if (!p.second.track_hashes.empty())
+                report(p.second);
+        }
+    }
+}
+
+static bool LookupIndex(const std::string& index_path, const std::string& image_path)
+{
+    auto entries = LoadIndex(index_path);
+    if (entries.empty())
+        throw util::exception(index_path, " is empty or missing");
+
+    IndexEntry entry;
+    entry.path = image_path;
+    if (!HashImage(entry))
+        throw util::exception("no track data found in ", image_path);
+
+    // Ensure the look-up image itself is considered
+    auto it = entries.find(entry.path);
+    if (it != entries.end())
+        entries.erase(it);
+    auto& target = entries[entry.path] = std::move(entry);
+
+    ReportMatches(entries, &target);
+    return true;
+}
+
+bool IndexImages(const std::string& dir_path, const std::string& index_path)
+{
+    if (!IsDir(dir_path))
+        return LookupIndex(dir_path, index_path);
+
+    auto old_entries = LoadIndex(index_path);
+    std::map<std::string, IndexEntry> entries;
+    std::vector<IndexEntry> pending;
+
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(dir_path, fs::directory_options::skip_permission_denied, ec);
+        !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        if (!it->is_regular_file(ec))
+            continue;
+
+        IndexEntry entry;
+        entry.path = it->path().string();
+        entry.size = it->file_size(ec);
+        entry.mtime = static_cast<int64_t>(it->last_write_time(ec).time_since_epoch().count());
+
+        // Reuse the existing hashes if the file looks unchanged
+        auto old = old_entries.find(entry.path);
+        if (old != old_entries.end() && old->second.size == entry.size && old->second.mtime == entry.mtime)
+            entries[entry.path] = std::move(old->second);
+        else
+            pending.push_back(std::move(entry));
+    }
+
+    auto reused = static_cast<int>(std::count_if(entries.begin(), entries.end(),
+        [](const std::pair<const std::string, IndexEntry>& p) { return !p.second.track_hashes.empty(); }));
+    std::atomic<int> done{ 0 };
+    std::vector<std::string> errors(pending.size());
+
+    auto hash_entry = [&](size_t i) {
+        try
+        {
+            HashImage(pending[i]);
+        }
+        catch (std::exception & e)
+        {
+            errors[i] = e.what();
+        }
+        catch (std::string & e)
+        {
+            errors[i] = e;
+        }
+        catch (...)
+        {
+            errors[i] = "unknown error";
+        }
+
+        // Anything not hashed is still stored, so it's skipped until it changes
+        if (!errors[i].empty())
+            pending[i].track_hashes.clear();
+        ++done;
+    };
+
+    // Images are independent, so hash them on the thread pool
+    if (opt.mt != 0 && ThreadPool::get_thread_count() > 1)
+    {
+        ThreadPool pool;
+        std::vector<std::future<void>> rets;
+        for (size_t i = 0; i < pending.size(); ++i)
+            rets.push_back(pool.enqueue(hash_entry, i));
+
+        for (auto& ret : rets)
+        {
+            ret.get();
+            Message(msgStatus, "Indexing... %d of %d", done.load(), static_cast<int>(pending.size()));
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < pending.size(); ++i)
+        {
+            Message(msgStatus, "Indexing... %d of %d", static_cast<int>(i), static_cast<int>(pending.size()));
+            hash_entry(i);
+        }
+    }
+
+    auto added = 0, no_data = 0;
+    std::vector<std::string> failures;
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+        if (!errors[i].empty())
+            failures.push_back(pending[i].path + ": " + errors[i]);
+        else if (pending[i].track_hashes.empty())
+            ++no_data;
+        else
+            ++added;
+
+        entries[pending[i].path] = std::move(pending[i]);
+    }
+
+    SaveIndex(index_path, entries);
+    Message(msgStatus, "");
+
+    util::cout << util::fmt("Indexed %d images (%d new, %d unchanged, %d without track data, %d failed)\n",
+        added + reused, added, reused, no_data, static_cast<int>(failures.size()));
+
+    for (auto& failure : failures)
+        util::cout << "  failed: " << failure << "\n";
+
+    ReportMatches(entries, nullptr);
+    return true;
+}
@@ -8,7 +8,7 @@ bool ImageInfo(const std::string& path)
     util::cout.screen->flush();
 
     auto disk = std::make_shared<Disk>();
-    if (ReadImage(opt.szSource, disk))
+    if (ProbeImage(path, disk))
     {
         const Format& fmt = disk->fmt;
         auto cyls = disk->cyls();
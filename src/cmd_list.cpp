@@ -392,6 +392,14 @@ bool ListDrives(int nVerbose_)
 }
 
 
+// Case-insensitive substring match, used for --label filtering
+static bool LabelMatch(const std::string& label, const std::string& find)
+{
+    return std::search(label.begin(), label.end(), find.begin(), find.end(), [](char a, char b) {
+        return std::tolower(static_cast<uint8_t>(a)) == std::tolower(static_cast<uint8_t>(b));
+        }) != label.end();
+}
+
 bool ListRecords(const std::string& path)
 {
     auto hdd = HDD::OpenDisk(path);
@@ -404,39 +412,39 @@ bool ListRecords(const std::string& path)
 
     BDOS_CAPS bdc;
     if (!IsBDOSDisk(*hdd, bdc))
-        util::cout << "BDOS disk signature not found\n";
-    else
     {
-        int nNamed = 0;
-        util::cout << util::fmt("Atom%s, %d records:\n\n", bdc.need_byteswap ? "" : " Lite", bdc.records);
+        util::cout << "BDOS disk signature not found\n";
+        return true;
+    }
 
-        for (auto i = 0; i < bdc.list_sectors; ++i)
-        {
-            MEMORY mem(hdd->sector_size);
-            hdd->Seek(bdc.base_sectors - bdc.list_sectors + i);
-            hdd->Read(mem, 1, bdc.need_byteswap);
+    util::cout << util::fmt("Atom%s, %d records:\n\n", bdc.need_byteswap ? "" : " Lite", bdc.records);
 
-            for (auto j = 0; j < (hdd->sector_size / BDOS_LABEL_SIZE); ++j)
-            {
-                uint8_t abRecord[BDOS_LABEL_SIZE + 1] = {};
-                memcpy(abRecord, mem + (j << 4), BDOS_LABEL_SIZE);
+    // Directory details and label searches need the full record index,
+    // which is only read from the disk if there's no cached copy.
+    auto records = GetRecordIndex(*hdd, path, bdc, !opt.verbose && opt.label.empty());
 
-                // Bit 7 should be ignored on label names
-                for (int k = 0; k < BDOS_LABEL_SIZE; ++k)
-                    abRecord[k] &= 0x7f;
+    int nNamed = 0;
+    for (auto& info : records)
+    {
+        if (!opt.label.empty() && !LabelMatch(info.label, opt.label) && !LabelMatch(info.disk_label, opt.label))
+            continue;
 
-                // Label in use?
-                if (abRecord[0])
-                {
-                    util::cout << util::fmt("%5u : %s\n", 1 + (i << 5) + j, abRecord);
-                    ++nNamed;
-                }
-            }
+        if (opt.verbose && info.formatted)
+        {
+            util::cout << util::fmt("%5u : %-16s %-16s %3d files  %016llx\n", info.record,
+                info.label.c_str(), info.disk_label.c_str(), info.files,
+                static_cast<unsigned long long>(info.checksum));
+            ++nNamed;
+        }
+        else if (!info.label.empty())
+        {
+            util::cout << util::fmt("%5u : %s\n", info.record, info.label.c_str());
+            ++nNamed;
         }
-
-        if (!nNamed)
-            util::cout << " No named records found\n";
     }
 
+    if (!nNamed)
+        util::cout << " No named records found\n";
+
     return true;
 }
@@ -0,0 +1,368 @@
+// BDOS record export and record index
+
+#include "SAMdisk.h"
+#include "ThreadPool.h"
+
+#include <deque>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+constexpr char RECORD_INDEX_SIGNATURE[] = "SDRX";
+constexpr uint32_t RECORD_INDEX_VERSION = 1;
+
+// Records read per sequential request, which is 12.5MB of data
+constexpr int RECORDS_PER_READ = 16;
+
+// Read the record list, with bit 7 of each label character stripped
+static std::vector<std::string> ReadRecordLabels(HDD& hdd, const BDOS_CAPS& bdc)
+{
+    MEMORY mem(bdc.list_sectors * hdd.sector_size);
+    if (!hdd.Seek(bdc.base_sectors - bdc.list_sectors) ||
+        hdd.Read(mem, bdc.list_sectors, bdc.need_byteswap) != bdc.list_sectors)
+        throw posix_error(errno, "read");
+
+    std::vector<std::string> labels(bdc.records);
+    for (auto i = 0; i < bdc.records && (i + 1) * BDOS_LABEL_SIZE <= mem.size; ++i)
+    {
+        std::string label;
+        for (auto j = 0; j < BDOS_LABEL_SIZE; ++j)
+        {
+            auto ch = static_cast<char>(mem[i * BDOS_LABEL_SIZE + j] & 0x7f);
+            if (!ch)
+                break;
+            label += ch;
+        }
+        labels[i] = util::trim(label);
+    }
+
+    return labels;
+}
+
+// Read records in large sequential blocks, passing each to the callback.
+// Partial final records are zero-padded to a full record.
+static void ReadRecords(HDD& hdd, const BDOS_CAPS& bdc,
+    const std::function<void(int record, Data&& data)>& fn)
+{
+    MEMORY mem(RECORDS_PER_READ * MGT_DISK_SIZE);
+
+    for (auto first = 1; first <= bdc.records; first += RECORDS_PER_READ)
+    {
+        auto start_sector = bdc.base_sectors + int64_t(BDOS_RECORD_SECTORS) * (first - 1);
+        auto sectors = static_cast<int>(std::min<int64_t>(
+            RECORDS_PER_READ * BDOS_RECORD_SECTORS, hdd.total_sectors - start_sector));
+
+        Message(msgStatus, "Reading record %d of %d", first, bdc.records);
+
+        if (!hdd.Seek(start_sector))
+            throw posix_error(errno, "seek");
+        else if (hdd.Read(mem, sectors, bdc.need_byteswap) != sectors)
+            throw posix_error(errno, "read");
+
+        auto count = std::min(RECORDS_PER_READ, bdc.records - first + 1);
+        for (auto i = 0; i < count; ++i)
+        {
+            auto offset = i * MGT_DISK_SIZE;
+            auto len = std::max(0, std::min(MGT_DISK_SIZE, sectors * hdd.sector_size - offset));
+
+            Data data(MGT_DISK_SIZE);
+            std::copy(mem.pb + offset, mem.pb + offset + len, data.begin());
+            fn(first + i, std::move(data));
+        }
+    }
+
+    Message(msgStatus, "");
+}
+
+// Summarise the MGT directory of a record image
+static RecordInfo SummariseRecord(int record, const std::string& label, const Data& data)
+{
+    RecordInfo info;
+    info.record = record;
+    info.label = label;
+    info.checksum = Fnv1a(data.data(), data.size());
+
+    auto pdir = reinterpret_cast<const MGT_DIR*>(data.data());
+    info.formatted = !memcmp(pdir->abBDOS, "BDOS", sizeof(pdir->abBDOS));
+    if (!info.formatted)
+        return info;
+
+    MGT_DISK_INFO di;
+    GetDiskInfo(data.data(), di);
+    info.disk_label = util::trim(di.disk_label);
+
+    // Directory tracks are on head 0, with tracks interleaved by head
+    for (auto cyl = 0; cyl < di.dir_tracks; ++cyl)
+    {
+        auto ptrack = data.data() + cyl * NORMAL_SIDES * MGT_TRACK_SIZE;
+        for (auto entry = 0; entry < MGT_TRACK_SIZE / static_cast<int>(sizeof(MGT_DIR)); ++entry)
+        {
+            auto p = reinterpret_cast<const MGT_DIR*>(ptrack) + entry;
+            if (p->bType & 0x3f)
+                ++info.files;
+            else if (!p->abName[0])
+                return info;
+        }
+    }
+
+    return info;
+}
+
+
+// Cached indexes are stored alongside image files, or in the user cache
+// directory for devices with a serial number to identify them.
+static std::string RecordIndexPath(const std::string& path, const HDD& hdd)
+{
+    if (IsFile(path))
+        return path + ".sdrx";
+
+    auto serial = util::trim(hdd.strSerialNumber);
+    if (serial.empty())
+        return "";
+
+#ifdef _WIN32
+    auto base = std::getenv("LOCALAPPDATA");
+#else
+    auto base = std::getenv("XDG_CACHE_HOME");
+    std::string home = std::getenv("HOME") ? std::getenv("HOME") : "";
+#endif
+
+    fs::path dir;
+    if (base && *base)
+        dir = fs::path(base) / "samdisk";
+#ifndef _WIN32
+    else if (!home.empty())
+        dir = fs::path(home) / ".cache" / "samdisk";
+#endif
+    else
+        return "";
+
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+
+    for (auto& ch : serial)
+    {
+        if (!std::isalnum(static_cast<uint8_t>(ch)))
+            ch = '_';
+    }
+
+    return (dir / (serial + ".sdrx")).string();
+}
+
+// Key to detect a changed disk: the geometry, record list, and the size
+// and modification time of image files. Devices have no modification time,
+// and checking record contents would cost nearly a full scan, so changes
+// that leave the record list alone need --force or an export to refresh.
+static uint64_t RecordIndexKey(const std::string& path, const HDD& hdd, const std::vector<std::string>& labels)
+{
+    auto key = Fnv1a(&hdd.total_sectors, sizeof(hdd.total_sectors));
+    for (auto& label : labels)
+        key = Fnv1a(label.c_str(), label.size() + 1, key);
+
+    std::error_code ec;
+    if (IsFile(path))
+    {
+        auto size = static_cast<uint64_t>(fs::file_size(path, ec));
+        auto mtime = static_cast<int64_t>(fs::last_write_time(path, ec).time_since_epoch().count());
+        key = Fnv1a(&size, sizeof(size), key);
+        key = Fnv1a(&mtime, sizeof(mtime), key);
+    }
+
+    return key;
+}
+
+static std::string ReadString(std::istream& is)
+{
+    std::string str(ReadValue<uint8_t>(is), '\0');
+    is.read(&str[0], str.size());
+    return str;
+}
+
+static void WriteString(std::ostream& os, const std::string& str)
+{
+    auto len = std::min(str.size(), size_t(255));
+    WriteValue<uint8_t>(os, static_cast<uint8_t>(len));
+    os.write(str.data(), len);
+}
+
+static bool LoadRecordIndex(const std::string& path, uint64_t key, std::vector<RecordInfo>& records)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    char sig[4]{};
+    file.read(sig, sizeof(sig));
+    if (std::memcmp(sig, RECORD_INDEX_SIGNATURE, sizeof(sig)) ||
+        ReadValue<uint32_t>(file) != RECORD_INDEX_VERSION ||
+        ReadValue<uint64_t>(file) != key)
+        return false;
+
+    records.resize(ReadValue<uint32_t>(file));
+    for (auto& info : records)
+    {
+        info.record = ReadValue<uint32_t>(file);
+        info.formatted = ReadValue<uint8_t>(file) != 0;
+        info.files = ReadValue<uint16_t>(file);
+        info.checksum = ReadValue<uint64_t>(file);
+        info.label = ReadString(file);
+        info.disk_label = ReadString(file);
+    }
+
+    return !!file;
+}
+
+static void SaveRecordIndex(const std::string& path, uint64_t key, const std::vector<RecordInfo>& records)
+{
+    auto tmp_path = path + ".tmp";
+    std::ofstream file(tmp_path, std::ios::binary);
+
+    file.write(RECORD_INDEX_SIGNATURE, 4);
+    WriteValue<uint32_t>(file, RECORD_INDEX_VERSION);
+    WriteValue<uint64_t>(file, key);
+    WriteValue<uint32_t>(file, static_cast<uint32_t>(records.size()));
+
+    for (auto& info : records)
+    {
+        WriteValue<uint32_t>(file, static_cast<uint32_t>(info.record));
+        WriteValue<uint8_t>(file, info.formatted ? 1 : 0);
+        WriteValue<uint16_t>(file, static_cast<uint16_t>(info.files));
+        WriteValue<uint64_t>(file, info.checksum);
+        WriteString(file, info.label);
+        WriteString(file, info.disk_label);
+    }
+
+    file.close();
+    if (!file || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tmp_path.c_str());
+        Message(msgWarning, "failed to write record index %s", path.c_str());
+    }
+}
+
+// Return the index of all records, reading the disk only if there's no
+// valid cached copy, or --force is used. If only labels are needed, the
+// record list alone is used.
+std::vector<RecordInfo> GetRecordIndex(HDD& hdd, const std::string& path, const BDOS_CAPS& bdc, bool labels_only)
+{
+    auto labels = ReadRecordLabels(hdd, bdc);
+
+    std::vector<RecordInfo> records;
+    if (labels_only)
+    {
+        for (auto i = 0; i < bdc.records; ++i)
+        {
+            RecordInfo info;
+            info.record = i + 1;
+            info.label = labels[i];
+            records.push_back(std::move(info));
+        }
+        return records;
+    }
+
+    auto index_path = RecordIndexPath(path, hdd);
+    auto key = index_path.empty() ? 0 : RecordIndexKey(path, hdd, labels);
+    if (!opt.force && !index_path.empty() && LoadRecordIndex(index_path, key, records))
+        return records;
+
+    records.clear();
+    ReadRecords(hdd, bdc, [&](int record, Data&& data) {
+        records.push_back(SummariseRecord(record, labels[record - 1], data));
+        });
+
+    if (!index_path.empty())
+        SaveRecordIndex(index_path, key, records);
+
+    return records;
+}
+
+
+// Safe file name for a record, from its number and label
+static std::string RecordFileName(const RecordInfo& info)
+{
+    std::string name = util::fmt("%05d", info.record);
+
+    auto label = info.label.empty() ? info.disk_label : info.label;
+    if (!label.empty())
+    {
+        for (auto& ch : label)
+        {
+            if (!std::isalnum(static_cast<uint8_t>(ch)) && ch != '-' && ch != '.')
+                ch = '_';
+        }
+        name += " " + label;
+    }
+
+    return name + ".mgt";
+}
+
+static RecordInfo ExportRecord(int record, const std::string& label, const Data& data, const std::string& dir_path)
+{
+    auto info = SummariseRecord(record, label, data);
+    if (!info.formatted && !opt.nosig)
+        return info;
+
+    auto disk = std::make_shared<Disk>();
+    disk->format(RegularFormat::MGT, data);
+    WriteImage((fs::path(dir_path) / RecordFileName(info)).string(), disk);
+
+    return info;
+}
+
+// Export all formatted records from a BDOS disk as MGT images. Records are
+// read in large sequential blocks, with the image writes done in parallel.
+bool ExportRecords(const std::string& hdd_path, const std::string& dir_path)
+{
+    auto hdd = HDD::OpenDisk(hdd_path);
+    if (!hdd)
+        throw util::exception("invalid disk");
+
+    BDOS_CAPS bdc;
+    if (!IsBDOSDisk(*hdd, bdc))
+        throw util::exception("drive is not BDOS format");
+
+    auto labels = ReadRecordLabels(*hdd, bdc);
+    std::vector<RecordInfo> records;
+
+    if (opt.mt != 0 && ThreadPool::get_thread_count() > 1)
+    {
+        ThreadPool pool;
+        std::deque<std::future<RecordInfo>> rets;
+
+        // Limit the records in flight, to bound memory use
+        auto max_pending = std::max(RECORDS_PER_READ, 2 * ThreadPool::get_thread_count());
+
+        ReadRecords(*hdd, bdc, [&](int record, Data&& data) {
+            rets.push_back(pool.enqueue([&, record](const Data& record_data) {
+                return ExportRecord(record, labels[record - 1], record_data, dir_path);
+                }, std::move(data)));
+
+            while (static_cast<int>(rets.size()) > max_pending)
+            {
+                records.push_back(rets.front().get());
+                rets.pop_front();
+            }
+            });
+
+        for (auto& ret : rets)
+            records.push_back(ret.get());
+    }
+    else
+    {
+        ReadRecords(*hdd, bdc, [&](int record, Data&& data) {
+            records.push_back(ExportRecord(record, labels[record - 1], data, dir_path));
+            });
+    }
+
+    // The data has all been read, so refresh the cached index too
+    auto index_path = RecordIndexPath(hdd_path, *hdd);
+    if (!index_path.empty())
+        SaveRecordIndex(index_path, RecordIndexKey(hdd_path, *hdd, labels), records);
+
+    auto exported = std::count_if(records.begin(), records.end(), [](const RecordInfo& info) {
+        return info.formatted || opt.nosig;
+        });
+
+    util::cout << util::fmt("Exported %d of %d records to ", static_cast<int>(exported), bdc.records) << dir_path << "\n";
+    return true;
+}
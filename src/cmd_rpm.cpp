@@ -2,6 +2,131 @@
 
 #include "SAMdisk.h"
 
+#include <cmath>
+
+// Revolution times (in us) from the flux between index pulses, which avoids
+// the cost of decoding the track just to find its length.
+static std::vector<int> FluxRevTimes(const FluxData& flux_revs)
+{
+    std::vector<int> rev_times;
+    rev_times.reserve(flux_revs.size());
+
+    for (auto& flux_times : flux_revs)
+    {
+        auto total_time = std::accumulate(flux_times.begin(), flux_times.end(), int64_t(0));
+        if (total_time)
+            rev_times.push_back(static_cast<int>(total_time / 1000));
+    }
+
+    return rev_times;
+}
+
+static std::string RevText(int time_us)
+{
+    auto rpm = 60'000'000.0f / time_us;
+
+    std::stringstream ss;
+    ss << std::setw(6) << time_us << " = " <<
+        std::setprecision(2) << std::fixed << rpm << " rpm";
+    return ss.str();
+}
+
+static void RevSummary(const std::vector<int>& rev_times)
+{
+    auto n = static_cast<int>(rev_times.size());
+    if (n < 2)
+        return;
+
+    auto minmax = std::minmax_element(rev_times.begin(), rev_times.end());
+    auto mean = std::accumulate(rev_times.begin(), rev_times.end(), 0.0) / n;
+
+    // Jitter is the standard deviation of the revolution times.
+    auto sum_sq = 0.0;
+    for (auto t : rev_times)
+        sum_sq += (t - mean) * (t - mean);
+    auto jitter = std::sqrt(sum_sq / n);
+
+    // Drift is the least-squares slope of revolution time over revolutions.
+    auto x_mean = (n - 1) / 2.0, sum_xy = 0.0, sum_xx = 0.0;
+    for (auto i = 0; i < n; ++i)
+    {
+        sum_xy += (i - x_mean) * (rev_times[i] - mean);
+        sum_xx += (i - x_mean) * (i - x_mean);
+    }
+    auto drift = sum_xy / sum_xx;
+
+    util::cout << "\n" << n << " revolutions:\n" <<
+        "   min " << RevText(*minmax.first) << "\n" <<
+        "  mean " << RevText(static_cast<int>(mean + 0.5)) << "\n" <<
+        "   max " << RevText(*minmax.second) << "\n" <<
+        util::fmt("  jitter %.2fus, drift %.2fus/rev\n", jitter, drift);
+
+    // Histogram of revolution times, spanning the min to max range.
+    constexpr auto BUCKETS = 10;
+    constexpr auto BAR_WIDTH = 40;
+    auto first_us = *minmax.first;
+    auto bucket_us = (*minmax.second - first_us + BUCKETS) / BUCKETS;
+
+    std::array<int, BUCKETS> counts{};
+    for (auto t : rev_times)
+        ++counts[(t - first_us) / bucket_us];
+    auto max_count = *std::max_element(counts.begin(), counts.end());
+
+    util::cout << "\n";
+    for (auto i = 0; i < BUCKETS; ++i)
+    {
+        auto bar = (counts[i] * BAR_WIDTH + max_count - 1) / max_count;
+        util::cout << std::setw(6) << (first_us + i * bucket_us) << "us " <<
+            std::setw(4) << counts[i] << " " << std::string(bar, '#') << "\n";
+    }
+}
+
+static bool FluxRpm(const std::shared_ptr<Disk>& disk, const CylHead& cylhead, int samples, bool forever)
+{
+    std::vector<int> rev_times;
+    std::vector<int> last_read;
+
+    // Sample the requested number of revolutions, or run forever if forced
+    for (auto i = 0; forever || static_cast<int>(rev_times.size()) < samples; ++i)
+    {
+        auto& trackdata = disk->read(cylhead, true);
+        if (!trackdata.has_flux())
+            return false;
+
+        auto read_times = FluxRevTimes(disk->read_flux(cylhead));
+        if (read_times.empty())
+        {
+            if (i == 0)
+                throw util::exception("no flux data available");
+            break;
+        }
+
+        // Identical timings mean a static image rather than a live drive.
+        if (read_times == last_read)
+            break;
+
+        for (auto time_us : read_times)
+        {
+            rev_times.push_back(time_us);
+
+            if (forever)
+            {
+                auto mean = std::accumulate(rev_times.begin(), rev_times.end(), 0.0) / rev_times.size();
+                util::cout << "\r" << RevText(time_us) <<
+                    util::fmt("  (mean %.2f rpm, Ctrl-C to stop)", 60'000'000.0 / mean);
+                util::cout.screen->flush();
+            }
+            else
+                util::cout << RevText(time_us) << "\n";
+        }
+
+        last_read = std::move(read_times);
+    }
+
+    RevSummary(rev_times);
+    return true;
+}
+
 bool DiskRpm(const std::string& path)
 {
     auto disk = std::make_shared<Disk>();
@@ -13,8 +138,14 @@ bool DiskRpm(const std::string& path)
         opt.range.cyl_end + 1, opt.range.head_end);
 
     auto forever = opt.force && util::is_stdout_a_tty();
+    auto samples = std::max(5, opt.rescans);
     opt.retries = opt.rescans = 0;
 
+    // Use the index timings directly for flux sources, with --rescans
+    // selecting a longer sample for the summary.
+    if (FluxRpm(disk, cylhead, samples, forever))
+        return true;
+
     // Display 5 revolutions, or run forever if forced
     for (auto i = 0; forever || i < 5; ++i)
     {
@@ -28,17 +159,10 @@ bool DiskRpm(const std::string& path)
             break;
         }
 
-        auto time_us = track.tracktime;
-        auto rpm = 60'000'000.0f / track.tracktime;
-
-        std::stringstream ss;
-        ss << std::setw(6) << time_us << " = " <<
-            std::setprecision(2) << std::fixed << rpm << " rpm";
-
         if (forever)
-            util::cout << "\r" << ss.str() << "  (Ctrl-C to stop)";
+            util::cout << "\r" << RevText(track.tracktime) << "  (Ctrl-C to stop)";
         else
-            util::cout << ss.str() << "\n";
+            util::cout << RevText(track.tracktime) << "\n";
 
         util::cout.screen->flush();
     }
@@ -115,13 +115,19 @@ bool ScanImage(const std::string& path, Range range)
             ValidateRange(range, MAX_TRACKS, MAX_SIDES, opt.step, disk->cyls(), disk->heads());
             util::cout << range << ":\n";
 
-            disk->preload(range, opt.step);
+            // Minimal scans read only the used tracks, so skip the bulk preload
+            auto used = opt.minimal ? GetUsedTracks(*disk) : UsedTracks().set();
+            if (!opt.minimal)
+                disk->preload(range, opt.step);
 
             ScanContext context;
             range.each([&](const CylHead cylhead) {
                 if (cylhead.cyl == range.cyl_begin)
                     context = ScanContext();
 
+                if (!used[cylhead])
+                    return;
+
                 auto track = disk->read_track(cylhead * opt.step);
 
                 NormaliseTrack(cylhead, track);
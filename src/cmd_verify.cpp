@@ -1,5 +1,203 @@
 // Verify command
 
 #include "SAMdisk.h"
+#include "DiskUtil.h"
+#include "ThreadPool.h"
 
-// ToDo!
+enum class VerifyDiff { Missing, Extra, Data, IdCrc, DataCrc, Dam };
+
+struct SectorDiff
+{
+    VerifyDiff type;
+    Header header;
+};
+
+// 64-bit FNV-1a, which is plenty to spot differences between two copies
+static uint64_t Digest(const void* pv, size_t len, uint64_t hash = 0xcbf29ce484222325ULL)
+{
+    auto pb = reinterpret_cast<const uint8_t*>(pv);
+    for (size_t i = 0; i < len; ++i)
+        hash = (hash ^ pb[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+// Digest of the sector details that matter for a verify, ignoring position
+static uint64_t SectorDigest(const Sector& sector)
+{
+    uint8_t details[] = {
+        static_cast<uint8_t>(sector.header.cyl), static_cast<uint8_t>(sector.header.head),
+        static_cast<uint8_t>(sector.header.sector), static_cast<uint8_t>(sector.header.size),
+        static_cast<uint8_t>(sector.has_badidcrc()), static_cast<uint8_t>(sector.has_baddatacrc()),
+        sector.dam };
+
+    auto hash = Digest(details, sizeof(details));
+    if (sector.has_data())
+    {
+        auto& data = sector.data_copy();
+        hash = Digest(data.data(), std::min(data.size(), sector.size()), hash);
+    }
+    return hash;
+}
+
+static std::vector<uint64_t> TrackDigests(const Track& track)
+{
+    std::vector<uint64_t> digests;
+    digests.reserve(track.size());
+    for (auto& sector : track)
+        digests.push_back(SectorDigest(sector));
+    return digests;
+}
+
+static std::vector<SectorDiff> CompareTracks(const Track& src_track, const Track& dst_track)
+{
+    std::vector<SectorDiff> diffs;
+
+    // Identical sector digests in the same order mean a matching track
+    auto src_digests = TrackDigests(src_track);
+    auto dst_digests = TrackDigests(dst_track);
+    if (src_digests == dst_digests)
+        return diffs;
+
+    // Target sectors not yet matched against a source sector
+    std::vector<bool> dst_used(dst_track.size());
+
+    for (auto i = 0; i < src_track.size(); ++i)
+    {
+        auto& sector = src_track[i];
+
+        // Prefer an unused target sector with the same digest, to cope with reordering
+        auto j = 0;
+        for (; j < dst_track.size(); ++j)
+        {
+            if (!dst_used[j] && dst_digests[j] == src_digests[i])
+                break;
+        }
+
+        if (j < dst_track.size())
+        {
+            dst_used[j] = true;
+            continue;
+        }
+
+        // Otherwise find the first unused target sector with a matching header
+        for (j = 0; j < dst_track.size(); ++j)
+        {
+            if (!dst_used[j] && dst_track[j].header == sector.header)
+                break;
+        }
+
+        if (j == dst_track.size())
+        {
+            diffs.push_back({ VerifyDiff::Missing, sector.header });
+            continue;
+        }
+
+        dst_used[j] = true;
+        auto& dst_sector = dst_track[j];
+
+        if (sector.has_badidcrc() != dst_sector.has_badidcrc())
+            diffs.push_back({ VerifyDiff::IdCrc, sector.header });
+        else if (sector.has_baddatacrc() != dst_sector.has_baddatacrc())
+            diffs.push_back({ VerifyDiff::DataCrc, sector.header });
+        else if (sector.dam != dst_sector.dam)
+            diffs.push_back({ VerifyDiff::Dam, sector.header });
+        else
+            diffs.push_back({ VerifyDiff::Data, sector.header });
+    }
+
+    for (auto j = 0; j < dst_track.size(); ++j)
+    {
+        if (!dst_used[j])
+            diffs.push_back({ VerifyDiff::Extra, dst_track[j].header });
+    }
+
+    return diffs;
+}
+
+static const char* DiffText(VerifyDiff type)
+{
+    switch (type)
+    {
+    case VerifyDiff::Missing:   return "missing from target";
+    case VerifyDiff::Extra:     return "only in target";
+    case VerifyDiff::Data:      return "data differs";
+    case VerifyDiff::IdCrc:     return "ID CRC status differs";
+    case VerifyDiff::DataCrc:   return "data CRC status differs";
+    case VerifyDiff::Dam:       return "data address mark differs";
+    }
+
+    return "";
+}
+
+bool VerifyImage(const std::string& src_path, const std::string& dst_path, Range range)
+{
+    auto src_disk = std::make_shared<Disk>();
+    auto dst_disk = std::make_shared<Disk>();
+    if (!ReadImage(src_path, src_disk) || !ReadImage(dst_path, dst_disk))
+        return false;
+
+    ValidateRange(range, MAX_TRACKS, MAX_SIDES, opt.step,
+        std::max(src_disk->cyls(), dst_disk->cyls()), std::max(src_disk->heads(), dst_disk->heads()));
+
+    // Load both sides first, which is only done in parallel for image files.
+    // Minimal verifies read only the used tracks, so skip the bulk preload.
+    // The target is read without the source cylinder step.
+    auto used = opt.minimal ? GetUsedTracks(*src_disk) : UsedTracks().set();
+    auto preloaded = !opt.minimal && src_disk->preload(range, opt.step) && dst_disk->preload(range, 1);
+
+    std::vector<CylHead> cylheads;
+    range.each([&](const CylHead& cylhead) {
+        if (used[cylhead])
+            cylheads.push_back(cylhead);
+        }, opt.cylsfirst == 1);
+
+    // Compare the tracks in parallel, then report the results in order.
+    // Devices must not be read from several threads, so that's only done
+    // once both sides have been fully loaded.
+    std::vector<std::vector<SectorDiff>> results(cylheads.size());
+    auto compare = [&](size_t i) {
+        auto& src_track = src_disk->read_track(cylheads[i] * opt.step);
+        auto& dst_track = dst_disk->read_track(cylheads[i]);
+        results[i] = CompareTracks(src_track, dst_track);
+    };
+
+    if (preloaded)
+    {
+        ThreadPool pool;
+        std::vector<std::future<void>> rets;
+        for (size_t i = 0; i < cylheads.size(); ++i)
+            rets.push_back(pool.enqueue(compare, i));
+        for (auto& ret : rets)
+            ret.get();
+    }
+    else
+    {
+        for (size_t i = 0; i < cylheads.size(); ++i)
+            compare(i);
+    }
+
+    auto diff_tracks = 0, diff_sectors = 0;
+    for (size_t i = 0; i < cylheads.size(); ++i)
+    {
+        if (results[i].empty())
+            continue;
+
+        ++diff_tracks;
+        for (auto& diff : results[i])
+        {
+            util::cout << cylheads[i] << " sector " << RecordStr(diff.header.sector) <<
+                ": " << colour::RED << DiffText(diff.type) << colour::none << "\n";
+            ++diff_sectors;
+        }
+    }
+
+    if (diff_tracks)
+    {
+        util::cout << util::fmt("%d difference%s on %d of %d tracks\n",
+            diff_sectors, (diff_sectors == 1) ? "" : "s", diff_tracks, static_cast<int>(cylheads.size()));
+        return false;
+    }
+
+    util::cout << util::fmt("All %d tracks match\n", static_cast<int>(cylheads.size()));
+    return true;
+}
@@ -6,26 +6,35 @@
 
 extern IMAGE_ENTRY aImageTypes[];
 extern DEVICE_ENTRY aDeviceTypes[];
+extern PROBE_ENTRY aProbeTypes[];
 
 #define ADD_IMAGE_RW(x)     bool Read##x (MemFile&, std::shared_ptr<Disk> &); \
                             bool Write##x (FILE*,   std::shared_ptr<Disk> &);
+#define ADD_IMAGE_RW_BITSTREAM(x) ADD_IMAGE_RW(x)
+#define ADD_IMAGE_RW_FLUX(x) ADD_IMAGE_RW(x)
 #define ADD_IMAGE_RO(x)     bool Read##x (MemFile&, std::shared_ptr<Disk> &);
 #define ADD_IMAGE_WO(x)     bool Write##x (FILE*,   std::shared_ptr<Disk> &);
 #define ADD_IMAGE_HIDDEN_RO(x)  bool Read##x (MemFile&, std::shared_ptr<Disk> &);
 
 #define ADD_DEVICE(x)       bool Read##x (const std::string &, std::shared_ptr<Disk> &); \
                             bool Write##x (const std::string &, std::shared_ptr<Disk> &);
+
+#define ADD_PROBE(x)        bool Probe##x (const std::string &, std::shared_ptr<Disk> &);
 #else
 
 #include "types.h"
 
 #define ADD_IMAGE_RW(x)     { #x, Read##x, Write##x },
+#define ADD_IMAGE_RW_BITSTREAM(x) { #x, Read##x, Write##x, PreferredData::Bitstream },
+#define ADD_IMAGE_RW_FLUX(x) { #x, Read##x, Write##x, PreferredData::Flux },
 #define ADD_IMAGE_RO(x)     { #x, Read##x, nullptr },
 #define ADD_IMAGE_WO(x)     { #x, nullptr, Write##x },
 #define ADD_IMAGE_HIDDEN_RO(x)  { "", Read##x, nullptr },
 
 #define ADD_DEVICE(x)       { #x, Read##x, Write##x },
 
+#define ADD_PROBE(x)        { #x, Probe##x },
+
 IMAGE_ENTRY aImageTypes[] = {
 
 #endif
@@ -47,8 +56,9 @@ IMAGE_ENTRY aImageTypes[] = {
     ADD_IMAGE_RO(DFI)
     ADD_IMAGE_RO(SCP)
     ADD_IMAGE_RO(STREAM)
-    ADD_IMAGE_RW(HFE)
-    ADD_IMAGE_RW(MFI)
+    ADD_IMAGE_RW_BITSTREAM(HFE)
+    ADD_IMAGE_RW_BITSTREAM(MFI)
+    ADD_IMAGE_RW_FLUX(SFI)
     ADD_IMAGE_RW(QDOS)
     ADD_IMAGE_RW(SAP)
     ADD_IMAGE_RO(WOZ)
@@ -119,9 +129,31 @@ ADD_DEVICE(FdrawcmdSysAB)
 };
 #endif
 
+
+#ifndef DECLARATIONS_ONLY
+
+// Header-only readers, for listing image details without the track payloads
+PROBE_ENTRY aProbeTypes[] = {
+
+#endif
+
+ADD_PROBE(SCP)
+ADD_PROBE(STREAM)
+ADD_PROBE(HFE)
+
+#ifndef DECLARATIONS_ONLY
+{
+    nullptr, nullptr
+}   // aProbeTypes list terminator
+};
+#endif
+
 #undef ADD_IMAGE_RW
+#undef ADD_IMAGE_RW_BITSTREAM
+#undef ADD_IMAGE_RW_FLUX
 #undef ADD_IMAGE_RO
 #undef ADD_IMAGE_WO
 #undef ADD_IMAGE_HIDDEN_RO
 
 #undef ADD_DEVICE
+#undef ADD_PROBE
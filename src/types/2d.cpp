@@ -1,6 +1,7 @@
 // 2D is a raw format used by PC-88 systems
 
 #include "SAMdisk.h"
+#include "RegularDisk.h"
 
 bool Read2D(MemFile& file, std::shared_ptr<Disk>& disk)
 {
@@ -10,7 +11,7 @@ bool Read2D(MemFile& file, std::shared_ptr<Disk>& disk)
         return false;
 
     file.rewind();
-    disk->format(fmt, file.data());
+    disk = std::make_shared<RegularDisk>(fmt, file.release());
     disk->strType = "2D";
 
     return true;
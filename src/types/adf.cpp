@@ -3,6 +3,7 @@
 //  http://lclevy.free.fr/adflib/adf_info.html
 
 #include "SAMdisk.h"
+#include "RegularDisk.h"
 
 #define ADF_SECTOR_SIZE         512
 #define ADF_BOOTBLOCK_SIZE      (ADF_SECTOR_SIZE * 2)   // bootblock is 2 sectors
@@ -46,8 +47,9 @@ bool ReadADF(MemFile& file, std::shared_ptr<Disk>& disk)
     if (~checksum)
         Message(msgWarning, "invalid AmigaDOS root block checksum");;
 
+    auto& fmt = (file.size() == fmtDD.disk_size()) ? fmtDD : fmtHD;
     file.rewind();
-    disk->format(file.size() == fmtDD.disk_size() ? fmtDD : fmtHD, file.data(), true);
+    disk = std::make_shared<RegularDisk>(fmt, file.release(), true);
     disk->strType = "ADF";
 
     return true;
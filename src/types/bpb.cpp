@@ -1,6 +1,7 @@
 // BIOS Parameter Block, for MS-DOS and compatible disks
 
 #include "SAMdisk.h"
+#include "RegularDisk.h"
 #include "bpb.h"
 
 bool ReadBPB(MemFile& file, std::shared_ptr<Disk>& disk)
@@ -42,7 +43,7 @@ bool ReadBPB(MemFile& file, std::shared_ptr<Disk>& disk)
         return false;
 
     file.rewind();
-    disk->format(fmt, file.data());
+    disk = std::make_shared<RegularDisk>(fmt, file.release());
     disk->strType = "BPB";
 
     return true;
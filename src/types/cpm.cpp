@@ -1,6 +1,7 @@
 // Basic support for SAM Coupe Pro-DOS images
 
 #include "SAMdisk.h"
+#include "RegularDisk.h"
 #include "types.h"
 
 bool ReadCPM(MemFile& file, std::shared_ptr<Disk>& disk)
@@ -12,7 +13,7 @@ bool ReadCPM(MemFile& file, std::shared_ptr<Disk>& disk)
         return false;
 
     file.rewind();
-    disk->format(fmt, file.data());
+    disk = std::make_shared<RegularDisk>(fmt, file.release());
     disk->strType = "Pro-DOS";
 
     return true;
@@ -2,6 +2,7 @@
 //  http://web.archive.org/web/20041020185446/http://zoom.czweb.org/files/mdos.htm
 
 #include "SAMdisk.h"
+#include "RegularDisk.h"
 
 #define D80_SIGNATURE   "SDOS"
 
@@ -34,7 +35,7 @@ bool ReadD80(MemFile& file, std::shared_ptr<Disk>& disk)
     }
 
     file.rewind();
-    disk->format(fmt, file.data());
+    disk = std::make_shared<RegularDisk>(fmt, file.release());
     disk->strType = "D80";
 
     return true;
@@ -1,6 +1,7 @@
 // Apple ][ DOS 3.3-ordered disk image
 
 #include "SAMdisk.h"
+#include "RegularDisk.h"
 
 // not used
 bool ReadDO(MemFile& file, std::shared_ptr<Disk>& disk)
@@ -12,7 +13,7 @@ bool ReadDO(MemFile& file, std::shared_ptr<Disk>& disk)
         return false;
 
     file.rewind();
-    disk->format(fmt, file.data());
+    disk = std::make_shared<RegularDisk>(fmt, file.release());
     disk->strType = "DO";
 
     return true;
@@ -2,6 +2,9 @@
 //  http://hxc2001.com/download/floppy_drive_emulator/SDCard_HxC_Floppy_Emulator_HFE_file_format.pdf
 
 #include "SAMdisk.h"
+#include "ThreadPool.h"
+
+#include <deque>
 
 // Note: currently only format revision 00 is supported.
 
@@ -98,20 +101,11 @@ std::string to_string(TrackEncoding track_encoding)
 }
 
 
-bool ReadHFE(MemFile& file, std::shared_ptr<Disk>& disk)
+static DataRate CheckHeader(const HFE_HEADER& hh)
 {
-    HFE_HEADER hh;
-    if (!file.rewind() || !file.read(&hh, sizeof(hh)) || std::string_view(hh.header_signature, sizeof(hh.header_signature)) != HFE_SIGNATURE)
-        return false;
-
     if (hh.format_revision != 0)
         throw util::exception("unsupported HFE format revision (", hh.format_revision, ")");
 
-    HFE_TRACK aTrackLUT[256];
-    auto track_lut_offset = util::letoh(hh.track_list_offset) << 9;
-    if (!file.seek(track_lut_offset) || !file.read(aTrackLUT, sizeof(aTrackLUT)))
-        throw util::exception("failed to read track LUT (@", track_lut_offset, ")");
-
     auto datarate = DataRate::Unknown;
     auto data_bitrate = util::letoh(hh.bitrate_kbps);
     if (data_bitrate >= 240 && data_bitrate <= 260)
@@ -126,6 +120,30 @@ bool ReadHFE(MemFile& file, std::shared_ptr<Disk>& disk)
         throw util::exception("unsupported data rate (", data_bitrate, "Kbps)");
 
     Format::Validate(hh.number_of_tracks, hh.number_of_sides);
+    return datarate;
+}
+
+static void AddHeaderMetadata(Disk& disk, const HFE_HEADER& hh)
+{
+    disk.metadata["interface_mode"] = to_string(static_cast<FloppyInterfaceMode>(hh.floppy_interface_mode));
+    disk.metadata["track_encoding"] = to_string(static_cast<TrackEncoding>(hh.track_encoding));
+    disk.metadata["data_bitrate"] = std::to_string(hh.bitrate_kbps) + "Kbps";
+    if (hh.floppy_rpm)
+        disk.metadata["floppy_rpm"] = std::to_string(hh.floppy_rpm);
+}
+
+bool ReadHFE(MemFile& file, std::shared_ptr<Disk>& disk)
+{
+    HFE_HEADER hh;
+    if (!file.rewind() || !file.read(&hh, sizeof(hh)) || std::string_view(hh.header_signature, sizeof(hh.header_signature)) != HFE_SIGNATURE)
+        return false;
+
+    auto datarate = CheckHeader(hh);
+
+    HFE_TRACK aTrackLUT[256];
+    auto track_lut_offset = util::letoh(hh.track_list_offset) << 9;
+    if (!file.seek(track_lut_offset) || !file.read(aTrackLUT, sizeof(aTrackLUT)))
+        throw util::exception("failed to read track LUT (@", track_lut_offset, ")");
 
     // 64K should be enough for maximum MFM track size, and we'll check later anyway
     MEMORY mem(0x10000);
@@ -163,16 +181,33 @@ bool ReadHFE(MemFile& file, std::shared_ptr<Disk>& disk)
         }
     }
 
-    disk->metadata["interface_mode"] = to_string(static_cast<FloppyInterfaceMode>(hh.floppy_interface_mode));
-    disk->metadata["track_encoding"] = to_string(static_cast<TrackEncoding>(hh.track_encoding));
-    disk->metadata["data_bitrate"] = std::to_string(hh.bitrate_kbps) + "Kbps";
-    if (hh.floppy_rpm)
-        disk->metadata["floppy_rpm"] = std::to_string(hh.floppy_rpm);
+    AddHeaderMetadata(*disk, hh);
 
     disk->strType = "HFE";
     return true;
 }
 
+// Header-only probe for image details, skipping the track bitstreams
+bool ProbeHFE(const std::string& path, std::shared_ptr<Disk>& disk)
+{
+    std::ifstream file(path, std::ios::binary);
+    HFE_HEADER hh;
+
+    if (!file.read(reinterpret_cast<char*>(&hh), sizeof(hh)) ||
+        std::string_view(hh.header_signature, sizeof(hh.header_signature)) != HFE_SIGNATURE)
+        return false;
+
+    CheckHeader(hh);
+
+    auto hfe_disk = std::make_shared<Disk>();
+    hfe_disk->resize(hh.number_of_tracks, hh.number_of_sides);
+    AddHeaderMetadata(*hfe_disk, hh);
+
+    hfe_disk->strType = "HFE";
+    disk = hfe_disk;
+    return true;
+}
+
 
 static uint8_t HfeTrackEncoding(const Track& track)
 {
@@ -254,6 +289,34 @@ static uint8_t HfeInterfaceMode(const Track& track)
     return GENERIC_SHUGART_DD_FLOPPYMODE;
 }
 
+// Bitstream bytes for one revolution of a track. HFE uses the same
+// LSB-first bit order as BitBuffer, so whole bytes are copied directly.
+static std::vector<uint8_t> HfeTrackBytes(const std::shared_ptr<Disk>& disk, const CylHead& cylhead)
+{
+    auto trackdata = disk->read(cylhead);
+    auto preferred = trackdata.preferred();
+    auto& bitstream = preferred.bitstream();
+
+    auto& data = bitstream.data();
+    auto bitsize = bitstream.size();
+    std::vector<uint8_t> track_bytes((bitstream.track_bitsize() + 7) / 8);
+
+    auto whole_bytes = std::min(static_cast<int>(track_bytes.size()), bitsize / 8);
+    std::copy_n(data.begin(), whole_bytes, track_bytes.begin());
+
+    // A partial final byte wraps to the start of the bitstream, as read8_lsb() does.
+    for (auto i = whole_bytes; i < static_cast<int>(track_bytes.size()); ++i)
+    {
+        for (auto bit = 0; bit < 8; ++bit)
+        {
+            auto pos = (i * 8 + bit) % bitsize;
+            track_bytes[i] |= ((data[pos >> 3] >> (pos & 7)) & 1) << bit;
+        }
+    }
+
+    return track_bytes;
+}
+
 bool WriteHFE(FILE* f_, std::shared_ptr<Disk>& disk)
 {
     std::vector<uint8_t> header(256, 0xff);
@@ -280,64 +343,96 @@ bool WriteHFE(FILE* f_, std::shared_ptr<Disk>& disk)
 
     if (!fwrite(header.data(), header.size(), 1, f_))
         throw util::exception("write error");
-    if (fseek(f_, hh.track_list_offset << 9, SEEK_SET))
-        throw util::exception("seek error");
 
     std::array<HFE_TRACK, MAX_TRACKS> aTrackLUT{};
-    std::map<CylHead, BitBuffer> bitstreams;
     int data_offset = 2;
 
-    auto max_disk_track_bytes = 0;
-    for (uint8_t cyl = 0; cyl < hh.number_of_tracks; ++cyl)
-    {
-        auto max_track_bytes = 0;
+    // Interleaved track buffer, reused between cylinders. Only the bytes
+    // covered by each track are written, as with a single full-size buffer.
+    std::vector<uint8_t> mem;
+
+    auto encode_cyl = [&](uint8_t cyl) {
+        std::vector<std::vector<uint8_t>> heads;
         for (uint8_t head = 0; head < hh.number_of_sides; ++head)
-        {
-            CylHead cylhead(cyl, head);
-            auto trackdata = disk->read(cylhead);
-            auto bitstream = trackdata.preferred().bitstream();
-            auto track_bytes = (bitstream.track_bitsize() + 7) / 8;
-            max_track_bytes = std::max(track_bytes, max_track_bytes);
-            max_disk_track_bytes = std::max(max_disk_track_bytes, max_track_bytes);
-            bitstreams[cylhead] = std::move(bitstream);
-        }
+            heads.push_back(HfeTrackBytes(disk, CylHead(cyl, head)));
+        return heads;
+    };
+
+    // Each cylinder's position follows from the sizes of those before it,
+    // so it can be written as soon as it's encoded, with the LUT last.
+    auto write_cyl = [&](uint8_t cyl, const std::vector<std::vector<uint8_t>>& heads) {
+        auto max_track_bytes = 0;
+        for (auto& track_bytes : heads)
+            max_track_bytes = std::max(max_track_bytes, static_cast<int>(track_bytes.size()));
 
         aTrackLUT[cyl].offset = util::htole(static_cast<uint16_t>(data_offset));
         aTrackLUT[cyl].track_len = util::htole(static_cast<uint16_t>(max_track_bytes * 2));
+        auto track_len = (max_track_bytes * 2 + 511) & ~0x1ff;
 
-        data_offset += ((max_track_bytes * 2) / 512) + 1;
-    }
+        if (static_cast<int>(mem.size()) < track_len)
+            mem.resize(track_len);
 
-    if (fwrite(aTrackLUT.data(), sizeof(aTrackLUT[0]), aTrackLUT.size(), f_) != aTrackLUT.size())
-        throw util::exception("write error");
-
-    MEMORY mem(max_disk_track_bytes * 2 + 512);
-    for (uint8_t cyl = 0; cyl < hh.number_of_tracks; ++cyl)
-    {
-        uint8_t* pbTrack{};
-        for (uint8_t head = 0; head < hh.number_of_sides; ++head)
+        for (uint8_t head = 0; head < heads.size(); ++head)
         {
-            auto& bitstream = bitstreams[{ cyl, head }];
-            auto track_bytes = (bitstream.track_bitsize() + 7) / 8;
-            bitstream.seek(0);
+            auto it = heads[head].begin();
+            auto track_bytes = static_cast<int>(heads[head].size());
 
-            pbTrack = mem.pb + head * 256;
+            // Each head fills alternate 256-byte halves of 512-byte blocks
+            auto pbTrack = mem.data() + head * 256;
             while (track_bytes > 0)
             {
                 auto chunk_size = std::min(track_bytes, 0x100);
-                for (int i = 0; i < chunk_size; ++i)
-                    *pbTrack++ = bitstream.read8_lsb();
+                pbTrack = std::copy_n(it, chunk_size, pbTrack);
                 memset(pbTrack, 0x55, 0x100 - chunk_size);
                 pbTrack += 0x200 - chunk_size;
+                it += chunk_size;
                 track_bytes -= chunk_size;
             }
         }
 
-        fseek(f_, util::letoh(aTrackLUT[cyl].offset) * 512, SEEK_SET);
-        auto track_len = (util::letoh(aTrackLUT[cyl].track_len) + 511) & ~0x1ff;
-        if (fwrite(mem.pb, 1, track_len, f_) != static_cast<size_t>(track_len))
+        if (fseek(f_, data_offset * 512, SEEK_SET))
+            throw util::exception("seek error");
+        if (fwrite(mem.data(), 1, track_len, f_) != static_cast<size_t>(track_len))
             throw util::exception("write error");
+
+        data_offset += ((max_track_bytes * 2) / 512) + 1;
+    };
+
+    if (opt.mt != 0 && ThreadPool::get_thread_count() > 1)
+    {
+        ThreadPool pool;
+        std::deque<std::future<std::vector<std::vector<uint8_t>>>> rets;
+
+        // Limit the cylinders in flight, to bound memory use
+        auto max_pending = 2 * ThreadPool::get_thread_count();
+
+        for (uint8_t cyl = 0; cyl < hh.number_of_tracks; ++cyl)
+        {
+            rets.push_back(pool.enqueue(encode_cyl, cyl));
+
+            if (static_cast<int>(rets.size()) > max_pending)
+            {
+                write_cyl(static_cast<uint8_t>(cyl - max_pending), rets.front().get());
+                rets.pop_front();
+            }
+        }
+
+        for (auto cyl = hh.number_of_tracks - static_cast<int>(rets.size()); !rets.empty(); ++cyl)
+        {
+            write_cyl(static_cast<uint8_t>(cyl), rets.front().get());
+            rets.pop_front();
+        }
+    }
+    else
+    {
+        for (uint8_t cyl = 0; cyl < hh.number_of_tracks; ++cyl)
+            write_cyl(cyl, encode_cyl(cyl));
     }
 
+    if (fseek(f_, hh.track_list_offset << 9, SEEK_SET))
+        throw util::exception("seek error");
+    if (fwrite(aTrackLUT.data(), sizeof(aTrackLUT[0]), aTrackLUT.size(), f_) != aTrackLUT.size())
+        throw util::exception("write error");
+
     return true;
 }
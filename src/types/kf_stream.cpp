@@ -5,28 +5,40 @@
 #include "KryoFlux.h"
 
 
-bool ReadSTREAM(MemFile& file, std::shared_ptr<Disk>& disk)
+// Check for a trackNN.H.raw stream path, returning the base and extension
+static bool IsStreamPath(const std::string& path, std::string& base, std::string& ext)
 {
-    uint8_t type;
-
-    std::string path = file.path();
-    if (!IsFileExt(path, "raw") || !file.rewind() || !file.read(&type, sizeof(type)) || type != KryoFlux::OOB)
-        return false;
-
     auto len = path.length();
-    if (len < 8 || !std::isdigit(static_cast<uint8_t>(path[len - 8])) ||
+    if (!IsFileExt(path, "raw") || len < 8 ||
+        !std::isdigit(static_cast<uint8_t>(path[len - 8])) ||
         !std::isdigit(static_cast<uint8_t>(path[len - 7])) ||
         path[len - 6] != '.' ||
         !std::isdigit(static_cast<uint8_t>(path[len - 5])))
         return false;
 
-    auto ext = path.substr(len - 3);
-    path = path.substr(0, len - 8);
+    ext = path.substr(len - 3);
+    base = path.substr(0, len - 8);
+    return true;
+}
+
+static std::string TrackPath(const std::string& base, const std::string& ext, const CylHead& cylhead)
+{
+    return util::fmt("%s%02u.%u.%s", base.c_str(), cylhead.cyl, cylhead.head, ext.c_str());
+}
+
+bool ReadSTREAM(MemFile& file, std::shared_ptr<Disk>& disk)
+{
+    uint8_t type;
+    std::string path, ext;
+
+    if (!IsStreamPath(file.path(), path, ext) ||
+        !file.rewind() || !file.read(&type, sizeof(type)) || type != KryoFlux::OOB)
+        return false;
 
     auto missing0 = 0, missing1 = 0, missing_total = 0;
 
     Range(MAX_TRACKS, MAX_SIDES).each([&](const CylHead& cylhead) {
-        auto track_path = util::fmt("%s%02u.%u.%s", path.c_str(), cylhead.cyl, cylhead.head, ext.c_str());
+        auto track_path = TrackPath(path, ext, cylhead);
 
         MemFile f;
         if (!IsFile(track_path) || !f.open(track_path))
@@ -64,3 +76,32 @@ bool ReadSTREAM(MemFile& file, std::shared_ptr<Disk>& disk)
 
     return true;
 }
+
+// Probe for image details, which only checks which stream files exist rather
+// than loading and decoding every one of them.
+bool ProbeSTREAM(const std::string& path, std::shared_ptr<Disk>& disk)
+{
+    std::string base, ext;
+    if (!IsStreamPath(path, base, ext))
+        return false;
+
+    std::ifstream file(path, std::ios::binary);
+    if (file.get() != KryoFlux::OOB)
+        return false;
+
+    auto stream_disk = std::make_shared<Disk>();
+    auto tracks = 0;
+
+    Range(MAX_TRACKS, MAX_SIDES).each([&](const CylHead& cylhead) {
+        if (IsFile(TrackPath(base, ext, cylhead)))
+        {
+            stream_disk->write(TrackData(cylhead));
+            ++tracks;
+        }
+        });
+
+    stream_disk->metadata["tracks"] = std::to_string(tracks);
+    stream_disk->strType = "STREAM";
+    disk = stream_disk;
+    return true;
+}
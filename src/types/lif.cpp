@@ -2,6 +2,7 @@
 //  http://www.hpmuseum.org/cgi-sys/cgiwrap/hpmuseum/articles.cgi?read=260
 
 #include "SAMdisk.h"
+#include "RegularDisk.h"
 
 bool ReadLIF(MemFile& file, std::shared_ptr<Disk>& disk)
 {
@@ -12,7 +13,7 @@ bool ReadLIF(MemFile& file, std::shared_ptr<Disk>& disk)
         return false;
 
     file.rewind();
-    disk->format(fmt, file.data());
+    disk = std::make_shared<RegularDisk>(fmt, file.release());
     disk->strType = "LIF";
 
     return true;
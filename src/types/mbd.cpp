@@ -3,6 +3,7 @@
 //  http://z00m.speccy.cz/docs/bsdos308-techman-en.txt (English)
 
 #include "SAMdisk.h"
+#include "RegularDisk.h"
 
 struct MBD_BOOTSECTOR
 {
@@ -60,7 +61,7 @@ bool ReadMBD(MemFile& file, std::shared_ptr<Disk>& disk)
     fmt.Validate();
 
     file.rewind();
-    disk->format(fmt, file.data());
+    disk = std::make_shared<RegularDisk>(fmt, file.release());
     disk->strType = "MBD";
 
     return true;
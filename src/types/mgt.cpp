@@ -4,6 +4,7 @@
 // Also accepts IMG variant with different track order.
 
 #include "SAMdisk.h"
+#include "RegularDisk.h"
 #include "SAMCoupe.h"
 
 bool ReadMGT(MemFile& file, std::shared_ptr<Disk>& disk)
@@ -44,7 +45,7 @@ bool ReadMGT(MemFile& file, std::shared_ptr<Disk>& disk)
         return false;
 
     file.rewind();
-    disk->format(Format(RegularFormat::MGT), file.data(), img);
+    disk = std::make_shared<RegularDisk>(Format(RegularFormat::MGT), file.release(), img);
     disk->strType = img ? "IMG" : "MGT";
 
     return true;
@@ -2,6 +2,7 @@
 //  http://www.worldofspectrum.org/opus.html
 
 #include "SAMdisk.h"
+#include "RegularDisk.h"
 #include "opd.h"
 
 const uint8_t OP_JR = 0x18; // Z80 opcode for unconditional relative jump
@@ -28,7 +29,7 @@ bool ReadOPD(MemFile& file, std::shared_ptr<Disk>& disk)
     fmt.Validate();
 
     file.rewind();
-    disk->format(fmt, file.data(), true);
+    disk = std::make_shared<RegularDisk>(fmt, file.release(), true);
     disk->strType = "OPD";
 
     return true;
@@ -3,6 +3,7 @@
 // http://www.qdosmsq.dunbar-it.co.uk/doku.php?id=qdosmsq:fs:dsdd
 
 #include "SAMdisk.h"
+#include "RegularDisk.h"
 #include "qdos.h"
 
 bool ReadQDOS(MemFile& file, std::shared_ptr<Disk>& disk)
@@ -31,11 +32,11 @@ bool ReadQDOS(MemFile& file, std::shared_ptr<Disk>& disk)
     if (fmt.disk_size() != file.size())
         Message(msgWarning, "image file isn't expected size (%d)", fmt.disk_size());
 
+    disk = std::make_shared<RegularDisk>(fmt, file.release());
+
     auto label = util::trim(std::string(qh.label, sizeof(qh.label)));
     disk->metadata["label"] = label;
     disk->metadata["type"] = std::string(qh.signature, sizeof(qh.signature));
-
-    disk->format(fmt, file.data());
     disk->strType = "QDOS (Sinclair QL)";
     return true;
 }
@@ -1,6 +1,7 @@
 // Raw image files matched by file size alone
 
 #include "SAMdisk.h"
+#include "RegularDisk.h"
 
 bool ReadRAW(MemFile& file, std::shared_ptr<Disk>& disk)
 {
@@ -62,7 +63,7 @@ bool ReadRAW(MemFile& file, std::shared_ptr<Disk>& disk)
     }
 
     file.rewind();
-    disk->format(fmt, file.data());
+    disk = std::make_shared<RegularDisk>(fmt, file.release());
     disk->strType = "RAW";
 
     return true;
@@ -80,49 +81,65 @@ bool WriteRAW(FILE* f_, std::shared_ptr<Disk>& disk)
     fmt.heads = 0;
     fmt.base = 0xff;
 
-    disk->each([&](const CylHead& cylhead, const Track& track) {
-        // Skip empty tracks
-        if (track.empty())
-            return;
-
-        // Track the used disk extent
-        fmt.cyls = std::max(fmt.cyls, cylhead.cyl + 1);
-        fmt.heads = std::max(fmt.heads, cylhead.head + 1);
-
-        // Keep track of the largest sector count
-        if (track.size() > fmt.sectors)
-            fmt.sectors = static_cast<uint8_t>(track.size());
-
-        // First track?
-        if (fmt.datarate == DataRate::Unknown)
-        {
-            // Find a typical sector to use as a template
-            ScanContext context;
-            Sector typical = GetTypicalSector(cylhead, track, context.sector);
-
-            fmt.datarate = typical.datarate;
-            fmt.encoding = typical.encoding;
-            fmt.size = typical.header.size;
-        }
-
-        for (auto& s : track.sectors())
-        {
-            // Track the lowest sector number
-            if (s.header.sector < fmt.base)
-                fmt.base = s.header.sector;
-
-            // Track the highest sector number
-            if (s.header.sector > max_id)
-                max_id = s.header.sector;
-
-            if (s.datarate != fmt.datarate)
-                throw util::exception("mixed data rates are unsuitable for raw output");
-            else if (s.encoding != fmt.encoding)
-                throw util::exception("mixed data encodings are unsuitable for raw output");
-            else if (s.header.size != fmt.size)
-                throw util::exception("mixed sector sizes are unsuitable for raw output");
-        }
+    // An untouched regular format disk already knows its format
+    auto regular_disk = dynamic_cast<RegularDisk*>(disk.get());
+    if (regular_disk && regular_disk->pristine())
+    {
+        fmt.cyls = disk->fmt.cyls;
+        fmt.heads = disk->fmt.heads;
+        fmt.sectors = disk->fmt.sectors;
+        fmt.size = disk->fmt.size;
+        fmt.base = disk->fmt.base;
+        fmt.datarate = disk->fmt.datarate;
+        fmt.encoding = disk->fmt.encoding;
+        max_id = fmt.base + fmt.sectors - 1;
+    }
+    else
+    {
+        disk->each([&](const CylHead& cylhead, const Track& track) {
+            // Skip empty tracks
+            if (track.empty())
+                return;
+
+            // Track the used disk extent
+            fmt.cyls = std::max(fmt.cyls, cylhead.cyl + 1);
+            fmt.heads = std::max(fmt.heads, cylhead.head + 1);
+
+            // Keep track of the largest sector count
+            if (track.size() > fmt.sectors)
+                fmt.sectors = static_cast<uint8_t>(track.size());
+
+            // First track?
+            if (fmt.datarate == DataRate::Unknown)
+            {
+                // Find a typical sector to use as a template
+                ScanContext context;
+                Sector typical = GetTypicalSector(cylhead, track, context.sector);
+
+                fmt.datarate = typical.datarate;
+                fmt.encoding = typical.encoding;
+                fmt.size = typical.header.size;
+            }
+
+            for (auto& s : track.sectors())
+            {
+                // Track the lowest sector number
+                if (s.header.sector < fmt.base)
+                    fmt.base = s.header.sector;
+
+                // Track the highest sector number
+                if (s.header.sector > max_id)
+                    max_id = s.header.sector;
+
+                if (s.datarate != fmt.datarate)
+                    throw util::exception("mixed data rates are unsuitable for raw output");
+                else if (s.encoding != fmt.encoding)
+                    throw util::exception("mixed data encodings are unsuitable for raw output");
+                else if (s.header.size != fmt.size)
+                    throw util::exception("mixed sector sizes are unsuitable for raw output");
+            }
         });
+    }
 
     if (fmt.datarate == DataRate::Unknown)
         throw util::exception("source disk is blank");
@@ -145,20 +145,8 @@ private:
     bool m_normalised = false;
 };
 
-bool ReadSCP(MemFile& file, std::shared_ptr<Disk>& disk)
+static void CheckHeader(const SCP_FILE_HEADER& fh)
 {
-    SCP_FILE_HEADER fh{};
-
-    if (!file.rewind() || !file.read(&fh, sizeof(fh)) || std::string(fh.signature, 3) != "SCP")
-        return false;
-
-    if (!(fh.flags & FLAG_MODE) && fh.checksum)
-    {
-        auto checksum = std::accumulate(file.data().begin() + STANDARD_TDH_OFFSET, file.data().end(), uint32_t(0));
-        if (checksum != util::letoh(fh.checksum))
-            Message(msgWarning, "file checksum is incorrect!");
-    }
-
     /*if (!(fh.flags & FLAG_INDEX))
         throw util::exception("not an index-synchronised image");
     else*/ if (fh.flags & FLAG_EXTENDED)
@@ -169,11 +157,12 @@ bool ReadSCP(MemFile& file, std::shared_ptr<Disk>& disk)
         throw util::exception("unsupported bit cell width (", fh.bitcell_width, ")");
     else if (fh.heads > 2)
         throw util::exception("unsupported heads value (", fh.heads, ")");
+}
 
-    std::vector<uint32_t> tdh_offsets(fh.end_track + 1);
-    if (!file.read(tdh_offsets))
-        throw util::exception("short file reading track offset index");
-
+// Check the track index matches the heads in the header, returning the
+// track number multiplier needed for legacy single-sided images.
+static int CheckTrackIndex(const SCP_FILE_HEADER& fh, std::vector<uint32_t>& tdh_offsets)
+{
     auto track_mult = 1;
     if (fh.heads > 0)
     {
@@ -203,6 +192,61 @@ bool ReadSCP(MemFile& file, std::shared_ptr<Disk>& disk)
         }
     }
 
+    return track_mult;
+}
+
+static void AddFooterMetadata(Disk& disk, const SCP_FILE_FOOTER& ff,
+    const std::function<std::string(uint32_t)>& footer_string)
+{
+    disk.metadata["manufacturer"] = footer_string(ff.manufacturer_offset);
+    disk.metadata["model"] = footer_string(ff.model_offset);
+    disk.metadata["serial"] = footer_string(ff.serial_offset);
+    disk.metadata["creator"] = footer_string(ff.creator_offset);
+    disk.metadata["application"] = footer_string(ff.application_offset);
+    disk.metadata["comment"] = footer_string(ff.comments_offset);
+
+    disk.metadata["app_version"] = FooterVersion(ff.application_version);
+    disk.metadata["hw_version"] = FooterVersion(ff.hardware_version);
+    disk.metadata["fw_version"] = FooterVersion(ff.firmware_version);
+    disk.metadata["scp_version"] = FooterVersion(ff.format_revision);
+
+    disk.metadata["created"] = FooterTime(ff.creation_time);
+    if (ff.modification_time != ff.creation_time)
+        disk.metadata["modified"] = FooterTime(ff.modification_time);
+}
+
+static void AddFlagMetadata(Disk& disk, const SCP_FILE_HEADER& fh)
+{
+    disk.metadata["revolutions"] = std::to_string(fh.revolutions);
+    disk.metadata["index"] = (fh.flags & FLAG_INDEX) ? "synchronised" : "unsynchronised";
+    disk.metadata["tpi"] = (fh.flags & FLAG_TPI) ? "96 tpi" : "48 tpi";
+    disk.metadata["rpm"] = (fh.flags & FLAG_RPM) ? "360 rpm" : "300 rpm";
+    disk.metadata["quality"] = (fh.flags & FLAG_TYPE) ? "normalised" : "preservation";
+    disk.metadata["mode"] = (fh.flags & FLAG_MODE) ? "read/write" : "read-only";
+    disk.metadata["media"] = (fh.flags & FLAG_EXTENDED) ? "extended/non-floppy" : "floppy disk image";
+}
+
+bool ReadSCP(MemFile& file, std::shared_ptr<Disk>& disk)
+{
+    SCP_FILE_HEADER fh{};
+
+    if (!file.rewind() || !file.read(&fh, sizeof(fh)) || std::string(fh.signature, 3) != "SCP")
+        return false;
+
+    if (!(fh.flags & FLAG_MODE) && fh.checksum)
+    {
+        auto checksum = std::accumulate(file.data().begin() + STANDARD_TDH_OFFSET, file.data().end(), uint32_t(0));
+        if (checksum != util::letoh(fh.checksum))
+            Message(msgWarning, "file checksum is incorrect!");
+    }
+
+    CheckHeader(fh);
+
+    std::vector<uint32_t> tdh_offsets(fh.end_track + 1);
+    if (!file.read(tdh_offsets))
+        throw util::exception("short file reading track offset index");
+
+    auto track_mult = CheckTrackIndex(fh, tdh_offsets);
     auto scp_disk = std::make_shared<SCPDisk>((fh.flags & FLAG_TYPE) != 0);
 
     for (int tracknr = 0; tracknr < static_cast<int>(tdh_offsets.size()); ++tracknr)
@@ -251,21 +295,9 @@ bool ReadSCP(MemFile& file, std::shared_ptr<Disk>& disk)
         if (file.seek(footer_offset) && file.read(&ff, sizeof(ff)) &&
             std::string(ff.sig, sizeof(ff.sig)) == "FPCS")
         {
-            scp_disk->metadata["manufacturer"] = FooterString(file, ff.manufacturer_offset);
-            scp_disk->metadata["model"] = FooterString(file, ff.model_offset);
-            scp_disk->metadata["serial"] = FooterString(file, ff.serial_offset);
-            scp_disk->metadata["creator"] = FooterString(file, ff.creator_offset);
-            scp_disk->metadata["application"] = FooterString(file, ff.application_offset);
-            scp_disk->metadata["comment"] = FooterString(file, ff.comments_offset);
-
-            scp_disk->metadata["app_version"] = FooterVersion(ff.application_version);
-            scp_disk->metadata["hw_version"] = FooterVersion(ff.hardware_version);
-            scp_disk->metadata["fw_version"] = FooterVersion(ff.firmware_version);
-            scp_disk->metadata["scp_version"] = FooterVersion(ff.format_revision);
-
-            scp_disk->metadata["created"] = FooterTime(ff.creation_time);
-            if (ff.modification_time != ff.creation_time)
-                scp_disk->metadata["modified"] = FooterTime(ff.modification_time);
+            AddFooterMetadata(*scp_disk, ff, [&](uint32_t offset) {
+                return FooterString(file, offset);
+                });
         }
     }
     else
@@ -279,12 +311,107 @@ bool ReadSCP(MemFile& file, std::shared_ptr<Disk>& disk)
         scp_disk->metadata["created"] = ss.str();
     }
 
-    scp_disk->metadata["index"] = (fh.flags & FLAG_INDEX) ? "synchronised" : "unsynchronised";
-    scp_disk->metadata["tpi"] = (fh.flags & FLAG_TPI) ? "96 tpi" : "48 tpi";
-    scp_disk->metadata["rpm"] = (fh.flags & FLAG_RPM) ? "360 rpm" : "300 rpm";
-    scp_disk->metadata["quality"] = (fh.flags & FLAG_TYPE) ? "normalised" : "preservation";
-    scp_disk->metadata["mode"] = (fh.flags & FLAG_MODE) ? "read/write" : "read-only";
-    scp_disk->metadata["media"] = (fh.flags & FLAG_EXTENDED) ? "extended/non-floppy" : "floppy disk image";
+    AddFlagMetadata(*scp_disk, fh);
+
+    scp_disk->strType = "SCP";
+    disk = scp_disk;
+
+    return true;
+}
+
+// Header-only probe for image details, which reads the track headers and
+// footer but skips the flux data and whole-file checksum.
+bool ProbeSCP(const std::string& path, std::shared_ptr<Disk>& disk)
+{
+    std::ifstream file(path, std::ios::binary);
+    SCP_FILE_HEADER fh{};
+
+    if (!file.read(reinterpret_cast<char*>(&fh), sizeof(fh)) || std::string(fh.signature, 3) != "SCP")
+        return false;
+
+    CheckHeader(fh);
+
+    std::vector<uint32_t> tdh_offsets(fh.end_track + 1);
+    if (!file.read(reinterpret_cast<char*>(tdh_offsets.data()), tdh_offsets.size() * sizeof(tdh_offsets[0])))
+        throw util::exception("short file reading track offset index");
+
+    auto track_mult = CheckTrackIndex(fh, tdh_offsets);
+    auto scp_disk = std::make_shared<Disk>();
+    int64_t data_end = file.tellg();
+
+    for (int tracknr = 0; tracknr < static_cast<int>(tdh_offsets.size()); ++tracknr)
+    {
+        if (!tdh_offsets[tracknr])
+            continue;
+
+        TRACK_DATA_HEADER tdh{};
+        CylHead cylhead(tracknr >> 1, tracknr & 1);
+        std::vector<uint32_t> rev_index(fh.revolutions * 3);
+
+        if (!file.seekg(tdh_offsets[tracknr]) || !file.read(reinterpret_cast<char*>(&tdh), sizeof(tdh)) ||
+            !file.read(reinterpret_cast<char*>(rev_index.data()), rev_index.size() * sizeof(rev_index[0])))
+            throw util::exception("short file reading ", cylhead, " track header");
+        else if (std::string(tdh.signature, 3) != "TRK")
+            throw util::exception("invalid track signature on ", cylhead);
+        else if (tdh.tracknr * track_mult != tracknr)
+            throw util::exception("track number mismatch (", tdh.tracknr * track_mult, " != ", tracknr, ") in ", cylhead, " header");
+
+        // Find where the flux data ends, without reading it
+        for (uint8_t rev = 0; rev < fh.revolutions; ++rev)
+        {
+            auto flux_count = util::letoh<uint32_t>(rev_index[rev * 3 + 1]);
+            auto data_offset = util::letoh<uint32_t>(rev_index[rev * 3 + 2]);
+            data_end = std::max(data_end, static_cast<int64_t>(tdh_offsets[tracknr]) + data_offset + flux_count * 2);
+        }
+
+        // Empty tracks are enough to give the disk its geometry
+        scp_disk->write(TrackData(cylhead));
+    }
+
+    file.clear();
+    file.seekg(0, std::ios::end);
+    int64_t file_size = file.tellg();
+
+    auto footer_offset = file_size - static_cast<int64_t>(sizeof(SCP_FILE_FOOTER));
+    if ((fh.flags & FLAG_FOOTER) && footer_offset >= data_end)
+    {
+        SCP_FILE_FOOTER ff{};
+
+        if (file.seekg(footer_offset) && file.read(reinterpret_cast<char*>(&ff), sizeof(ff)) &&
+            std::string(ff.sig, sizeof(ff.sig)) == "FPCS")
+        {
+            AddFooterMetadata(*scp_disk, ff, [&](uint32_t offset) {
+                uint16_t len = 0;
+                if (!offset || !file.seekg(offset) || !file.read(reinterpret_cast<char*>(&len), sizeof(len)))
+                    return std::string();
+
+                len = util::letoh(len);
+                if (offset + len >= file_size)
+                    return std::string();
+
+                std::string str(len, '\0');
+                if (!file.read(&str[0], len))
+                    return std::string();
+
+                return str;
+                });
+        }
+    }
+    else
+    {
+        scp_disk->metadata["app_version"] = FooterVersion(fh.revision);
+        scp_disk->metadata["creator"] = (fh.flags & FLAG_CREATOR) ? "Unknown" : "SuperCard Pro";
+
+        std::stringstream ss;
+        char c;
+        file.clear();
+        file.seekg(data_end);
+        while (file.get(c) && std::isprint(static_cast<uint8_t>(c)))
+            ss << c;
+        scp_disk->metadata["created"] = ss.str();
+    }
+
+    AddFlagMetadata(*scp_disk, fh);
 
     scp_disk->strType = "SCP";
     disk = scp_disk;
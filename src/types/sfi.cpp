@@ -0,0 +1,316 @@
+// SAMdisk flux image, a native container for flux captures
+//
+// A fixed header is followed by an index with an entry for every track, so
+// any track can be located without reading the others. Each track holds its
+// revolutions, as split by the index pulses, with every flux interval (in ns)
+// stored as a little-endian base-128 varint. Most intervals fit in 2 bytes.
+// Track data is zlib-compressed where that makes it smaller.
+
+#include "SAMdisk.h"
+#include "DemandDisk.h"
+
+#ifdef HAVE_ZLIB
+#include "zlib.h"
+#endif
+
+constexpr char SFI_SIGNATURE[] = "SAMFLUX\x1a";
+constexpr uint8_t SFI_VERSION = 1;
+
+// Note: all values are little-endian
+struct SFI_FILE_HEADER
+{
+    char signature[8];          // "SAMFLUX\x1a"
+    uint8_t version;
+    uint8_t cyls, heads;
+    uint8_t reserved;
+    uint32_t metadata_offset;   // key and value string pairs, each null-terminated
+    uint32_t metadata_size;
+};
+
+struct SFI_TRACK_ENTRY
+{
+    uint32_t offset;            // zero for no track
+    uint32_t size;              // size of stored data
+    uint32_t data_size;         // size of data once uncompressed
+    uint8_t revs;
+    uint8_t flags;
+    uint16_t reserved;
+};
+
+enum
+{
+    TRACK_COMPRESSED = 1 << 0,
+    TRACK_NORMALISED = 1 << 1
+};
+
+static_assert(sizeof(SFI_FILE_HEADER) == 20, "SFI_FILE_HEADER size is wrong");
+static_assert(sizeof(SFI_TRACK_ENTRY) == 16, "SFI_TRACK_ENTRY size is wrong");
+
+
+static void AddVarint(Data& data, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        data.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+static bool GetVarint(const uint8_t*& p, const uint8_t* end, uint32_t& value)
+{
+    value = 0;
+    for (auto shift = 0; p < end && shift < 32; shift += 7)
+    {
+        auto b = *p++;
+        value |= static_cast<uint32_t>(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+
+class SFIDisk final : public DemandDisk
+{
+public:
+    explicit SFIDisk(Data&& file_data) : m_file_data(std::move(file_data)) {}
+
+    void add_track_entry(const CylHead& cylhead, const SFI_TRACK_ENTRY& entry)
+    {
+        m_entries[cylhead] = entry;
+        extend(cylhead);
+    }
+
+protected:
+    TrackData load(const CylHead& cylhead, bool /*first_read*/) override
+    {
+        auto it = m_entries.find(cylhead);
+        if (it == m_entries.end())
+            return TrackData(cylhead);
+
+        auto& entry = it->second;
+        auto stored = m_file_data.data() + entry.offset;
+        Data track_data;
+
+        if (entry.flags & TRACK_COMPRESSED)
+        {
+#ifndef HAVE_ZLIB
+            throw util::exception("compressed SFI tracks are not supported without ZLIB");
+#else
+            track_data.resize(entry.data_size);
+            uLongf size = entry.data_size;
+            auto rc = uncompress(track_data.data(), &size, stored, entry.size);
+            if (rc != Z_OK || size != entry.data_size)
+                throw util::exception("decompression of ", cylhead, " failed (", rc, ")");
+#endif
+        }
+        else
+            track_data.assign(stored, stored + entry.size);
+
+        FluxData flux_revs;
+        flux_revs.reserve(entry.revs);
+
+        const uint8_t* p = track_data.data();
+        auto end = p + track_data.size();
+
+        for (auto rev = 0; rev < entry.revs; ++rev)
+        {
+            uint32_t count = 0;
+            if (!GetVarint(p, end, count) || count > static_cast<uint32_t>(end - p))
+                throw util::exception("invalid flux data on ", cylhead);
+
+            std::vector<uint32_t> flux_times(count);
+            for (auto& time : flux_times)
+            {
+                if (!GetVarint(p, end, time))
+                    throw util::exception("invalid flux data on ", cylhead);
+            }
+
+            flux_revs.push_back(std::move(flux_times));
+        }
+
+        return TrackData(cylhead, std::move(flux_revs), (entry.flags & TRACK_NORMALISED) != 0);
+    }
+
+private:
+    Data m_file_data{};
+    std::map<CylHead, SFI_TRACK_ENTRY> m_entries{};
+};
+
+
+bool ReadSFI(MemFile& file, std::shared_ptr<Disk>& disk)
+{
+    SFI_FILE_HEADER fh{};
+
+    if (!file.rewind() || !file.read(&fh, sizeof(fh)) ||
+        memcmp(fh.signature, SFI_SIGNATURE, sizeof(fh.signature)))
+        return false;
+
+    if (fh.version != SFI_VERSION)
+        throw util::exception("unsupported SFI version (", static_cast<int>(fh.version), ")");
+    else if (fh.cyls > MAX_DISK_CYLS || fh.heads > MAX_DISK_HEADS)
+        throw util::exception("invalid SFI geometry (", static_cast<int>(fh.cyls), "/", static_cast<int>(fh.heads), ")");
+
+    std::vector<SFI_TRACK_ENTRY> index(fh.cyls * fh.heads);
+    if (!file.read(index))
+        throw util::exception("short file reading track index");
+
+    std::vector<std::pair<CylHead, SFI_TRACK_ENTRY>> entries;
+    for (auto cyl = 0; cyl < fh.cyls; ++cyl)
+    {
+        for (auto head = 0; head < fh.heads; ++head)
+        {
+            auto entry = index[cyl * fh.heads + head];
+            entry.offset = util::letoh(entry.offset);
+            entry.size = util::letoh(entry.size);
+            entry.data_size = util::letoh(entry.data_size);
+
+            CylHead cylhead(cyl, head);
+            if (!entry.offset)
+                continue;
+            else if (static_cast<uint64_t>(entry.offset) + entry.size > static_cast<uint64_t>(file.size()))
+                throw util::exception("short file reading ", cylhead, " data");
+
+            entries.emplace_back(cylhead, entry);
+        }
+    }
+
+    // Metadata is stored as a list of key and value string pairs
+    std::map<std::string, std::string> metadata_map;
+    auto metadata_offset = util::letoh(fh.metadata_offset);
+    auto metadata_size = util::letoh(fh.metadata_size);
+    if (metadata_size && file.seek(static_cast<int>(metadata_offset)))
+    {
+        auto metadata = file.read(static_cast<int>(metadata_size));
+        auto p = reinterpret_cast<const char*>(metadata.data());
+        auto end = p + metadata.size();
+
+        while (p < end)
+        {
+            auto key_end = std::find(p, end, '\0');
+            auto value_end = (key_end == end) ? end : std::find(key_end + 1, end, '\0');
+            if (value_end == end)
+                break;
+
+            metadata_map[std::string(p, key_end)] = std::string(key_end + 1, value_end);
+            p = value_end + 1;
+        }
+    }
+
+    // The disk keeps the file data for tracks to be decoded on demand
+    auto sfi_disk = std::make_shared<SFIDisk>(file.release());
+    for (auto& p : entries)
+        sfi_disk->add_track_entry(p.first, p.second);
+    sfi_disk->metadata = std::move(metadata_map);
+
+    sfi_disk->strType = "SFI";
+    disk = sfi_disk;
+
+    return true;
+}
+
+bool WriteSFI(FILE* f_, std::shared_ptr<Disk>& disk)
+{
+    auto cyls = disk->cyls();
+    auto heads = disk->heads();
+    if (cyls > 255)
+        throw util::exception("too many cylinders for SFI format");
+
+    SFI_FILE_HEADER fh{};
+    std::vector<SFI_TRACK_ENTRY> index(cyls * heads);
+
+    Data metadata;
+    for (auto& p : disk->metadata)
+    {
+        metadata.insert(metadata.end(), p.first.begin(), p.first.end());
+        metadata.push_back(0);
+        metadata.insert(metadata.end(), p.second.begin(), p.second.end());
+        metadata.push_back(0);
+    }
+
+    // Offsets are 32-bit, so the image must stay within 4GB
+    auto check_size = [](uint64_t size) {
+        if (size > std::numeric_limits<uint32_t>::max())
+            throw util::exception("image is too big for SFI format");
+    };
+
+    uint64_t pos = sizeof(fh) + index.size() * sizeof(index[0]);
+    check_size(pos + metadata.size());
+    fh.metadata_offset = util::htole(static_cast<uint32_t>(pos));
+    fh.metadata_size = util::htole(static_cast<uint32_t>(metadata.size()));
+
+    // The blank header and index hold their space until they're complete,
+    // so only the start of the file is ever sought, whatever its size.
+    if (fwrite(&fh, sizeof(fh), 1, f_) != 1 ||
+        fwrite(index.data(), sizeof(index[0]), index.size(), f_) != index.size() ||
+        fwrite(metadata.data(), 1, metadata.size(), f_) != static_cast<size_t>(metadata.size()))
+        throw util::exception("write error");
+    pos += metadata.size();
+
+    for (auto cyl = 0; cyl < cyls; ++cyl)
+    {
+        for (auto head = 0; head < heads; ++head)
+        {
+            CylHead cylhead(cyl, head);
+
+            auto& trackdata = disk->read(cylhead);
+            if (!trackdata.has_track() && !trackdata.has_bitstream() && !trackdata.has_flux())
+                continue;
+
+            auto normalised = trackdata.has_normalised_flux();
+            auto& flux_revs = disk->read_flux(cylhead);
+            if (flux_revs.size() > 255)
+                throw util::exception("too many revolutions on ", cylhead, " for SFI format");
+
+            Data track_data;
+            for (auto& flux_times : flux_revs)
+            {
+                AddVarint(track_data, static_cast<uint32_t>(flux_times.size()));
+                for (auto time : flux_times)
+                    AddVarint(track_data, time);
+            }
+
+            auto& entry = index[cyl * heads + head];
+            entry.revs = static_cast<uint8_t>(flux_revs.size());
+            entry.flags = normalised ? TRACK_NORMALISED : 0;
+            entry.data_size = static_cast<uint32_t>(track_data.size());
+
+#ifdef HAVE_ZLIB
+            // Keep the compressed form only if it's smaller
+            Data compressed(static_cast<int>(compressBound(track_data.size())));
+            uLongf size = compressed.size();
+            if (compress2(compressed.data(), &size, track_data.data(), track_data.size(), Z_BEST_SPEED) == Z_OK &&
+                size < static_cast<uLongf>(track_data.size()))
+            {
+                compressed.resize(static_cast<int>(size));
+                track_data = std::move(compressed);
+                entry.flags |= TRACK_COMPRESSED;
+            }
+#endif
+            check_size(pos + track_data.size());
+            entry.offset = static_cast<uint32_t>(pos);
+            entry.size = static_cast<uint32_t>(track_data.size());
+
+            if (fwrite(track_data.data(), 1, track_data.size(), f_) != static_cast<size_t>(track_data.size()))
+                throw util::exception("write error");
+            pos += entry.size;
+
+            entry.offset = util::htole(entry.offset);
+            entry.size = util::htole(entry.size);
+            entry.data_size = util::htole(entry.data_size);
+        }
+    }
+
+    std::memcpy(fh.signature, SFI_SIGNATURE, sizeof(fh.signature));
+    fh.version = SFI_VERSION;
+    fh.cyls = static_cast<uint8_t>(cyls);
+    fh.heads = static_cast<uint8_t>(heads);
+
+    if (fseek(f_, 0, SEEK_SET) < 0 ||
+        fwrite(&fh, sizeof(fh), 1, f_) != 1 ||
+        fwrite(index.data(), sizeof(index[0]), index.size(), f_) != index.size())
+        throw util::exception("write error");
+
+    return true;
+}
@@ -1,6 +1,7 @@
 // Atari ST
 
 #include "SAMdisk.h"
+#include "RegularDisk.h"
 #include "bpb.h"
 
 constexpr uint16_t ST_BOOT_CHECKSUM = 0x1234;
@@ -38,7 +39,7 @@ bool ReadST(MemFile& file, std::shared_ptr<Disk>& disk)
             fmt.datarate = DataRate::_500K;
 
         file.rewind();
-        disk->format(fmt, file.data());
+        disk = std::make_shared<RegularDisk>(fmt, file.release());
         disk->strType = "ST (BPB)";
         return true;
     }
@@ -58,7 +59,7 @@ bool ReadST(MemFile& file, std::shared_ptr<Disk>& disk)
                 if (fmt.disk_size() == file.size())
                 {
                     file.rewind();
-                    disk->format(fmt, file.data());
+                    disk = std::make_shared<RegularDisk>(fmt, file.release());
                     disk->strType = "ST";
                     return true;
                 }
@@ -3,6 +3,7 @@
 // Later extended to support up to 1MB images (128 cyls)
 
 #include "SAMdisk.h"
+#include "RegularDisk.h"
 #include "trd.h"
 
 bool ReadTRD(MemFile& file, std::shared_ptr<Disk>& disk)
@@ -81,7 +82,7 @@ bool ReadTRD(MemFile& file, std::shared_ptr<Disk>& disk)
     fmt.heads = heads;
 
     file.rewind();
-    disk->format(fmt, file.data());
+    disk = std::make_shared<RegularDisk>(fmt, file.release());
     disk->strType = "TRD";
 
     return true;
@@ -8,6 +8,7 @@ namespace util
 
 std::ofstream log;
 LogHelper cout(&std::cout);
+thread_local std::ostream* LogHelper::capture = nullptr;
 
 
 std::string fmt(const char* fmt, ...)
@@ -107,7 +108,7 @@ std::string lowercase(const std::string& str)
 LogHelper& operator<<(LogHelper& h, colour c)
 {
     // Colours are screen only
-    if (util::is_stdout_a_tty())
+    if (util::is_stdout_a_tty() && !LogHelper::capture)
     {
 #ifdef _WIN32
         h.screen->flush();
@@ -125,7 +126,7 @@ LogHelper& operator<<(LogHelper& h, colour c)
 
 LogHelper& operator<<(LogHelper& h, ttycmd cmd)
 {
-    if (util::is_stdout_a_tty())
+    if (util::is_stdout_a_tty() && !LogHelper::capture)
     {
         switch (cmd)
         {
@@ -0,0 +1,63 @@
+// Test image generator, writing raw sector images with distinct sector content
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static std::vector<unsigned char> MakeImage(int cyls, int heads, int sectors, int sector_size)
+{
+    std::vector<unsigned char> image;
+    image.reserve(static_cast<size_t>(cyls) * heads * sectors * sector_size);
+
+    // Tag each byte with its cyl/head/sector/offset so misplaced sectors are spotted
+    for (auto cyl = 0; cyl < cyls; ++cyl)
+        for (auto head = 0; head < heads; ++head)
+            for (auto sector = 0; sector < sectors; ++sector)
+                for (auto i = 0; i < sector_size; ++i)
+                    image.push_back(static_cast<unsigned char>(cyl * 7 + head * 101 + sector * 13 + i));
+
+    return image;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        std::fprintf(stderr, "Usage: %s <trd|mgt> <path>\n", argv[0]);
+        return 1;
+    }
+
+    std::string type = argv[1];
+    std::vector<unsigned char> image;
+
+    if (type == "trd")
+    {
+        // 80 cyls, 2 heads, 16 sectors of 256 bytes
+        image = MakeImage(80, 2, 16, 256);
+
+        // Directory of deleted entries, and disk info sector marking DS 80-track
+        for (auto i = 0; i < 128; ++i)
+            image[i * 16] = 0x01;
+        image[8 * 256 + 227] = 0x16;
+    }
+    else if (type == "mgt")
+    {
+        // 80 cyls, 2 heads, 10 sectors of 512 bytes
+        image = MakeImage(80, 2, 10, 512);
+    }
+    else
+    {
+        std::fprintf(stderr, "%s: unknown image type '%s'\n", argv[0], argv[1]);
+        return 1;
+    }
+
+    auto f = std::fopen(argv[2], "wb");
+    if (!f || std::fwrite(image.data(), image.size(), 1, f) != 1 || std::fclose(f))
+    {
+        std::fprintf(stderr, "%s: failed to write %s\n", argv[0], argv[2]);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,27 @@
+# Copy a generated regular image to a RAW image, which must be byte-identical.
+#
+# Expects SAMDISK, MKIMAGE, TYPE and WORK_DIR to be defined.
+
+file(MAKE_DIRECTORY ${WORK_DIR})
+set(src ${WORK_DIR}/source.${TYPE})
+set(dst ${WORK_DIR}/target.raw)
+file(REMOVE ${src} ${dst})
+
+execute_process(COMMAND ${MKIMAGE} ${TYPE} ${src} RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+  message(FATAL_ERROR "failed to create ${src}")
+endif()
+
+execute_process(COMMAND ${SAMDISK} copy ${src} ${dst}
+  RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE output)
+message("${output}")
+if (NOT result EQUAL 0)
+  message(FATAL_ERROR "copy failed")
+elseif (output MATCHES "missing")
+  message(FATAL_ERROR "copy reported missing sectors")
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${src} ${dst} RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+  message(FATAL_ERROR "${dst} differs from ${src}")
+endif()